@@ -1,3 +1,13 @@
+#include <bitset>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 #ifndef NUMBERS_h
     #include "numbers.hpp"
     #define NUMBERS_h
@@ -8,7 +18,33 @@
     #define MEMORY_h
 #endif
 
-struct CPU
+#ifndef POLICIES_h
+    #include "policies.hpp"
+    #define POLICIES_h
+#endif
+
+struct CPUState;
+
+// Device with work to do at given times: Update is called once the elapsed
+// cycles reach a deadline it asked for with CPUState::Schedule
+struct EventSource
+{
+    virtual ~EventSource() = default;
+    virtual void Update(CPUState& cpu) = 0;     // Raise interrupts and schedule the next event
+};
+
+// Event sources registered with one core. They hold on to that core, so a
+// copy or a move of the core starts with none instead of sharing them
+struct EventSources : std::vector<EventSource*>
+{
+    EventSources() = default;
+    EventSources(const EventSources&) {}
+    EventSources& operator=(const EventSources&) { return *this; }
+};
+
+// Registers, flags, cycle counters and interrupt lines, independent of the
+// core's policies
+struct CPUState
 {
     hword PC;    // program counter
     hword SP;    // stack pointer
@@ -23,18 +59,87 @@ struct CPU
     bool V; // overflow flag
     bool N; // negative flag
 
-    Memory memory;  // Memory object
-    word cycles;    // Number of execution cycles available
+    sword cycles;   // Number of execution cycles available
+    dword cycle_base;   // Total cycles granted so far (elapsed = cycle_base - cycles)
+
+    static constexpr word NMI_LINE = 0x80000000;    // Pending NMI
+    static constexpr word EVENT_LINE = 0x40000000;  // Deadline moved during a run
+    static constexpr word IRQ_LINES = ~(NMI_LINE | EVENT_LINE);     // One bit per IRQ source
+    static constexpr dword NEVER = ~(dword)0;   // No deadline
+
+    word pending = 0;   // Pending events, checked once per instruction
+    dword deadline = NEVER;     // Elapsed time of the next timed event
+    sword held = 0;     // Budget held back past the deadline
+    bool counts = false;    // The core's Timing policy counts cycles
+    bool timed = false;     // Inside a run that stops at deadlines
+    bool fuse = false;  // Loop idioms may run natively (cycle-bounded runs only)
+    dword fused_loops = 0;  // Loops run natively so far
+    EventSources event_sources;     // Devices with timed events
+
+    dword elapsed() const;  // Cycles executed since construction
+
+    void AssertIrq(word line = 0x01);   // Hold IRQ low for a source (level triggered)
+    void ReleaseIrq(word line = 0x01);  // Let go of IRQ for a source
+    void TriggerNmi();  // NMI edge, serviced once
+    void AddEventSource(EventSource*);  // Register a device with timed events
+    void RemoveEventSource(EventSource*);   // Unregister a device, before it goes away
+    void Schedule(dword when);  // Ask for an event once `when` cycles have elapsed
+    void UpdateEvents();    // Run the events that are due
+    void Steal(sword n);    // Charge cycles a device kept the bus busy for, like Tick
+    void HoldBack();    // Keep the budget past the deadline out of the run
+    void GiveBack();    // Return the held back budget
+
+    void SetZN(byte);   // Set zero and negative flags from a result
+    byte Status() const;    // Pack the flags into a status byte (NV-BDIZC)
+    void SetStatus(byte);   // Unpack a status byte into the flags (B is kept)
+};
+
+// 6502 core, configured at compile time:
+// - Bus: the memory the core is wired to (Memory interface)
+// - Trace: instruction tracer (see policies.hpp)
+// - Timing: cycle accounting on or off
+// - ISA: which opcodes are implemented
+// Policies that are not used compile to nothing.
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+struct Core : CPUState
+{
+    Bus memory;  // Memory object
+    [[no_unique_address]] Trace trace;  // Tracer object
+
+    // Native replacement for a guest subroutine: works on the registers and
+    // memory, returns the cycles the routine takes from its entry through RTS
+    using Hook = std::function<word(Core&)>;
+    struct Hooks
+    {
+        std::unordered_map<hword, Hook> entries;    // Hooked subroutine entry points
+        std::bitset<256> pages; // Pages holding at least one hook
+        Hook hypercall; // Host service behind the hypercall opcode, if any
+        byte hypercall_opcode = 0;  // Opcode that traps to it
+    };
+    std::shared_ptr<const Hooks> hooks; // Allocated by the first hook, shared by copies until changed
 
     // Constructors
-    CPU(word);
-    CPU(word, Memory);
+    Core(word);
+    Core(word, Bus);    // Takes the memory over: move it in, or copy it explicitly
 
     void reset();
  
+    void Tick(sword n = 1); // Consume cycles (no-op without cycle timing)
+    void Stall();   // Give up the rest of the cycle budget
     byte FetchInstruction();    // Load instruction from memory
+    hword FetchAddress();   // Load a 16-bit operand with a single read
     byte ReadByte(hword address);   // Byte fetch, absolute
     void WriteByte(hword address, byte data);   // Byte write, absolute
+    void Push(byte data);   // Push byte on the stack (page 1, grows down)
+    byte Pull();    // Pull byte from the stack
+    hword ReadVector(hword address);    // Fetch a 16-bit vector
+    bool Service();     // Handle pending events (deadline moves, NMI, IRQ unless masked), true if interrupted
+    void EnterInterrupt(hword vector);  // Push PC and status, jump through the vector
+    void AddHook(hword address, Hook);  // Run a native routine whenever JSR reaches address
+    void RemoveHook(hword address); // Go back to the guest routine
+    void CallHook();    // Run the hook at PC if there is one, then return like RTS
+    void SetHypercall(byte opcode, Hook);   // Trap an opcode that would stop the CPU to a host service, throws otherwise
+    bool Hypercall();   // Run the host service if the opcode just fetched traps to it
 
     // **** Addressing modes ****
 
@@ -64,16 +169,16 @@ struct CPU
     void ADC(byte); // Generic ADC operation
     void AND(byte); // Generic AND operation
     void ASL(byte); // Generic ASL operation
+    byte ShiftLeft(byte);   // Generic left shift, returns the result
     void Branch(byte, bool);  // Generic branch operation
+    void TakeBranch(bool);  // Conditional branch instruction: offset, then Branch
     void BIT(byte ); // Generic BIT operation
     void Compare(byte&, byte);  // Generic compare operation  
     void CMP(byte); // Generic CMP operation
     void CPX(byte); // Generic CPX operation
     void CPY(byte); // Generic CPY operation
-    void DEC(byte, hword);  // Generic DEC operation
     void Decrement(byte&);  // Generic register decrement
     void EOR(byte); // Generic EOR operation
-    void INC(byte, hword);  // Generic INC operation
     void Increment(byte&);  // Generic register increment
     void LD(byte&, byte);   // Generic LD(X-Y) operation
     byte LSR(byte); // Generic LSR operation
@@ -92,5 +197,69 @@ struct CPU
     void SLO(hword);    // Generic SLO operation
     void SRE(hword);    // Generic SRE operation
 
-    void execute(hword);  // Opcode decoding & execution
-};
\ No newline at end of file
+    // **** Opcode handlers ****
+    // One handler per opcode, generated from the opcode table in opcodes.hpp
+
+    template <AddrMode M>
+    byte Operand(); // Fetch the operand of a read instruction
+    template <AddrMode M>
+    hword EffectiveAddress();   // Fetch the target address of a write instruction
+    template <Operation Op, AddrMode M>
+    void Execute(); // One operation in one addressing mode
+    template <bool Copy>
+    bool FuseLoop();    // Run a copy or fill loop natively, if it starts here and it is safe
+
+    using Handler = void (*)(Core&);
+    template <Operation Op, AddrMode M>
+    static void Handle(Core&);  // Table entry for Execute<Op, M>
+    template <std::size_t... Opcodes>
+    static constexpr std::array<Handler, 256> MakeHandlers(std::index_sequence<Opcodes...>);
+    static const std::array<Handler, 256> handlers;    // Opcode dispatch table
+
+    // **** Execution ****
+
+    template <typename Proceed>
+    void run(Proceed);  // Opcode decoding & execution loop, while Proceed() holds
+    template <typename Slice>
+    void RunSlices(Slice) requires Timing::counts;  // Run slices up to each deadline, catching up with timed events in between
+    template <typename Proceed>
+    void RunTimed(Proceed) requires Timing::counts;     // run, stopping at each deadline for timed events
+
+    // Cycle-bounded runs need cycle timing
+    void execute(hword) requires Timing::counts;  // Set PC and run until the cycles are exhausted
+
+    // Resumable execution: PC, registers and cycle debt are kept between calls
+    word run_for_cycles(word) requires Timing::counts;  // Grant cycles and run them, returns cycles consumed
+    word run_for_instructions(word);    // Run N instructions, returns cycles consumed
+    word step();    // Run a single instruction, returns cycles consumed
+    bool run_until(hword, word) requires Timing::counts;    // Run until PC reaches address or cycles run out
+
+    // Ahead-of-time translated code (see recompiler.hpp): runs from PC while
+    // the budget lasts and no event is pending, false if PC is not translated
+    using Translation = bool (*)(Core&);
+    word run_translated(Translation, word) requires Timing::counts;  // run_for_cycles, through the translation where it covers PC
+};
+
+// **** Configurations ****
+// Defined in CPU.tpp and instantiated in CPU.cpp. Other configurations
+// can be instantiated by including CPU.tpp.
+
+using CPU = Core<Memory, NoTrace, CycleTiming, NMOS6502>;   // Default core
+using FuzzCPU = Core<Memory, NoTrace, NoTiming, NMOS6502>;  // Fastest, no accounting
+using DebugCPU = Core<Memory, PrintTrace, CycleTiming, NMOS6502>;   // Fully instrumented
+using DocumentedCPU = Core<Memory, NoTrace, CycleTiming, Documented6502>;   // No illegal opcodes
+using EmbeddedCPU = Core<MirroredRam<8 * 1024>, NoTrace, CycleTiming, NMOS6502>;   // 8 KiB of RAM, mirrored
+using ProfileCPU = Core<Memory, ProfileTrace, CycleTiming, NMOS6502>;   // Collects a profile for the recompiler
+using MeasureCPU = Core<Memory, MeasureTrace, CycleTiming, NMOS6502>;   // Times passes between two PCs
+
+// Translated code (see recompiler.hpp) instantiates the cores itself, so
+// their members inline into it
+#ifndef AF6502_INLINE_CORES
+extern template struct Core<Memory, NoTrace, CycleTiming, NMOS6502>;
+extern template struct Core<Memory, NoTrace, NoTiming, NMOS6502>;
+extern template struct Core<Memory, PrintTrace, CycleTiming, NMOS6502>;
+extern template struct Core<Memory, NoTrace, CycleTiming, Documented6502>;
+extern template struct Core<MirroredRam<8 * 1024>, NoTrace, CycleTiming, NMOS6502>;
+extern template struct Core<Memory, ProfileTrace, CycleTiming, NMOS6502>;
+extern template struct Core<Memory, MeasureTrace, CycleTiming, NMOS6502>;
+#endif
@@ -0,0 +1,1508 @@
+#include <algorithm>
+#include <cstdint>
+
+#ifndef CPU_h
+    #include "CPU.hpp"
+    #define CPU_h
+#endif
+
+#ifndef OPCODES_h
+    #include "opcodes.hpp"
+    #define OPCODES_h
+#endif
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+Core<Bus, Trace, Timing, ISA>::Core(word n_cycles)
+{
+    cycles = cycle_base = n_cycles;
+    counts = Timing::counts;
+    reset();
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+Core<Bus, Trace, Timing, ISA>::Core(word n_cycles, Bus mem) : memory(std::move(mem))
+{
+    cycles = cycle_base = n_cycles;
+    counts = Timing::counts;
+    reset();
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::reset()
+{
+    // Reset PC and SP to default values
+    PC = 0xFFC;
+    SP = 0x0100;
+
+    // Reset accumulator, registers and flags
+    A = X = Y = 0;
+    C = Z = I = D = B = V = N = false;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::Tick(sword n)
+{
+    if constexpr (Timing::counts)
+    {
+        cycles -= n;
+    }
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::Stall()
+{
+    if (cycles > 0)
+    {
+        cycles = 0;
+    }
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+byte Core<Bus, Trace, Timing, ISA>::FetchInstruction()
+{
+    Tick();
+    byte temp = memory[PC];
+    PC++;
+    return temp;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+hword Core<Bus, Trace, Timing, ISA>::FetchAddress()
+{
+    Tick(2);
+    hword temp = memory.ReadWord(PC);
+    PC += 2;
+    return temp;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+byte Core<Bus, Trace, Timing, ISA>::ReadByte(hword address)
+{
+    Tick();
+    return memory[address];
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::WriteByte(hword address, byte data)
+{
+    Tick();
+    memory.WriteByte(address, data);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::Push(byte data)
+{
+    WriteByte(0x0100 | (SP & 0x00FF), data);
+    SP = (SP - 1) & 0x00FF;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+byte Core<Bus, Trace, Timing, ISA>::Pull()
+{
+    SP = (SP + 1) & 0x00FF;
+    return ReadByte(0x0100 | SP);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+hword Core<Bus, Trace, Timing, ISA>::ReadVector(hword address)
+{
+    byte low = ReadByte(address);
+    byte high = ReadByte(address + 1);
+    return ((hword)high << 8) | (hword)low;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+bool Core<Bus, Trace, Timing, ISA>::Service()
+{
+    if (pending & EVENT_LINE)
+    {
+        pending &= ~EVENT_LINE;
+        if (timed)
+        {
+            HoldBack();
+        }
+    }
+
+    if (pending & NMI_LINE)
+    {
+        pending &= ~NMI_LINE;
+        EnterInterrupt(0xFFFA);
+        return true;
+    }
+    if ((pending & IRQ_LINES) && !I)
+    {
+        EnterInterrupt(0xFFFE);
+        return true;
+    }
+    return false;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::EnterInterrupt(hword vector)
+{
+    // Same frame as BRK, with B clear in the pushed status
+    Tick(2);
+    Push((byte)(PC >> 8));
+    Push((byte)(PC & 0xFF));
+    Push(Status() | 0x20);
+    I = 1;
+    PC = ReadVector(vector);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::AddHook(hword address, Hook hook)
+{
+    auto changed = hooks ? std::make_shared<Hooks>(*hooks) : std::make_shared<Hooks>();
+    changed->entries[address] = std::move(hook);
+    changed->pages.set(address >> 8);
+    hooks = std::move(changed);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::RemoveHook(hword address)
+{
+    if (!hooks)
+        return;
+    auto changed = std::make_shared<Hooks>(*hooks);
+    changed->entries.erase(address);
+    // The page stays flagged while it has other hooks
+    bool others = false;
+    for (const auto& [entry, hook] : changed->entries)
+        others |= (entry >> 8) == (address >> 8);
+    changed->pages.set(address >> 8, others);
+    hooks = std::move(changed);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::CallHook()
+{
+    auto held = hooks;  // The hook may change the hooks
+    auto found = held->entries.find(PC);
+    if (found == held->entries.end())
+        return;
+    // JSR already pushed the return address: the hook stands in for the
+    // body and the RTS, which pops it again (the two pulls tick for themselves)
+    Tick((sword)found->second(*this) - 2);
+    byte low = Pull();
+    byte high = Pull();
+    PC = (((hword)high << 8) | (hword)low) + 1;
+}
+
+// Only opcodes that would stop the processor can trap: the JAM opcodes,
+// and the ones the instruction set leaves undefined. Legal opcodes never
+// reach the check, so they are refused. An empty service turns the
+// hypercall off
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::SetHypercall(byte opcode, Hook service)
+{
+    if (ISA::Implements(opcode) && opcode_table[opcode].operation != Operation::JAM)
+    {
+        throw std::invalid_argument("SetHypercall: the opcode runs an instruction, it cannot trap");
+    }
+    auto changed = hooks ? std::make_shared<Hooks>(*hooks) : std::make_shared<Hooks>();
+    changed->hypercall = std::move(service);
+    changed->hypercall_opcode = opcode;
+    hooks = std::move(changed);
+}
+
+// The service takes its arguments in A, X and Y, may answer in them and
+// in memory, and returns the cycles it takes after the opcode fetch.
+// Execution goes on after the opcode
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+bool Core<Bus, Trace, Timing, ISA>::Hypercall()
+{
+    if (!hooks || !hooks->hypercall || memory[(hword)(PC - 1)] != hooks->hypercall_opcode)
+        return false;
+    auto held = hooks;  // The service may change the hooks
+    Tick((sword)held->hypercall(*this));
+    return true;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+byte Core<Bus, Trace, Timing, ISA>::IM()
+{
+    return FetchInstruction();
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+byte Core<Bus, Trace, Timing, ISA>::ZP()
+{
+    byte address = FetchInstruction();
+    return ReadByte(address);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+byte Core<Bus, Trace, Timing, ISA>::ZX()
+{
+    byte address = ((hword)FetchInstruction() + X) & 0x00FF;
+    Tick();
+    return ReadByte(address);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+byte Core<Bus, Trace, Timing, ISA>::ZY()
+{
+    byte address = ((hword)FetchInstruction() + Y) & 0x00FF;
+    Tick();
+    return ReadByte(address);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+byte Core<Bus, Trace, Timing, ISA>::AB()
+{
+    hword full_address = FetchAddress();
+    byte temp = ReadByte(full_address);
+    return temp;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+byte Core<Bus, Trace, Timing, ISA>::AX()
+{
+    hword full_address = FetchAddress();
+    hword carry_sum = (((full_address & 0x00FF) + X) >> 8) & 0x01;
+    full_address += X;
+    if (carry_sum)
+    {
+        Tick();
+    }
+    return ReadByte(full_address);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+byte Core<Bus, Trace, Timing, ISA>::AY()
+{
+    hword full_address = FetchAddress();
+    hword carry_sum = (((full_address & 0x00FF) + Y) >> 8) & 0x01;
+    full_address += Y;
+    if (carry_sum)
+    {
+        Tick();
+    }
+    return ReadByte(full_address);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+byte Core<Bus, Trace, Timing, ISA>::IX()
+{
+    hword imm_address = (FetchInstruction() + X) & 0x00FF;
+    Tick();
+    byte address = ReadByte(imm_address);
+    byte address_2 = ReadByte(++imm_address);
+    hword full_address = ((hword)address | (hword)(address_2 << 8));
+    return ReadByte(full_address);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+byte Core<Bus, Trace, Timing, ISA>::IY()
+{
+    byte imm_address = FetchInstruction();
+    byte address = ReadByte(imm_address);
+    byte address_2 = ReadByte(++imm_address);
+    hword full_address = (((hword)address_2 << 8) | (hword)address);
+    hword carry_sum = (((full_address & 0x00FF) + Y) >> 8) & 0x01;
+    if (carry_sum)
+    {
+        Tick();
+    }
+    full_address += Y;
+    return ReadByte(full_address);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+byte Core<Bus, Trace, Timing, ISA>::ZP_A()
+{
+    return FetchInstruction();
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+byte Core<Bus, Trace, Timing, ISA>::ZX_A()
+{
+    Tick();
+    return FetchInstruction() + X;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+byte Core<Bus, Trace, Timing, ISA>::ZY_A()
+{
+    Tick();
+    return FetchInstruction() + Y;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+hword Core<Bus, Trace, Timing, ISA>::AB_A()
+{
+    return FetchAddress();
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+hword Core<Bus, Trace, Timing, ISA>::AX_A()
+{
+    return FetchAddress() + X;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+hword Core<Bus, Trace, Timing, ISA>::AY_A()
+{
+    return FetchAddress() + Y;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+hword Core<Bus, Trace, Timing, ISA>::IX_A()
+{
+    byte imm_address = FetchInstruction() + X;
+    Tick();
+    byte address = ReadByte(imm_address);
+    byte address_2 = ReadByte(++imm_address);
+    return (((hword)address_2 << 8) | (hword)address);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+hword Core<Bus, Trace, Timing, ISA>::IY_A()
+{
+    byte imm_address = FetchInstruction();
+    byte address = ReadByte(imm_address);
+    byte address_2 = ReadByte(++imm_address);
+    Tick();
+    return ((((hword)address_2 << 8) | (hword)address)) + Y;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::ADC(byte operand)
+{
+    hword temp = (hword)operand + (hword)A;
+    C = temp > 255;
+    Z = (temp & 0x00FF) == 0;
+    N = temp & 0x80;
+    V = (~((hword)A ^ (hword)operand) & ((hword)A ^ (hword)temp)) & 0x0080;
+    A = temp & 0x00FF;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::AND(byte operand)
+{
+    A = A & operand;
+    Z = (A & 0x00FF) == 0;
+    N = A & 0x80;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::ASL(byte operand)
+{
+    A = ShiftLeft(operand);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+byte Core<Bus, Trace, Timing, ISA>::ShiftLeft(byte operand)
+{
+    hword temp = (hword)operand << 1;
+    C = temp > 255;
+    Z = (temp & 0x00FF) == 0;
+    N = temp & 0x80;
+    Tick();
+    return temp & 0x00FF;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::Branch(byte address, bool condition)
+{
+    word page = PC / 256;
+    if (condition)
+    {
+        PC += (std::int8_t)address;  // Relative offsets are signed
+    }
+    if (PC / 256 != page)
+    {
+        Tick(2);
+    }
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::TakeBranch(bool condition)
+{
+    // Branch charges both extra cycles of a crossing; a taken branch
+    // within its page costs one
+    byte offset = IM();
+    hword next = PC;
+    Branch(offset, condition);
+    if (condition && (PC >> 8) == (next >> 8))
+    {
+        Tick();
+    }
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::BIT(byte operand)
+{
+    Z = (A & operand) == 0;
+    N = (operand >> 7) & 0x01;
+    V = (operand >> 6) & 0x01;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::Compare(byte &reg, byte operand)
+{
+    hword temp = (hword)reg - (hword)operand;
+    Z = (temp == 0);
+    C = (temp >= 0);
+    N = (temp >> 7) & 0x1;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::CMP(byte operand)
+{
+    Compare(A, operand);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::CPX(byte operand)
+{
+    Compare(X, operand);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::CPY(byte operand)
+{
+    Compare(Y, operand);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::Decrement(byte &reg)
+{
+    reg--;
+    Z = ((reg & 0x00FF) == 0);
+    N = reg & 0x80;
+    Tick();
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::EOR(byte operand)
+{
+    A ^= operand;
+    Z = ((A & 0x00FF) == 0);
+    N = A & 0x80;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::Increment(byte &reg)
+{
+    reg++;
+    Z = ((reg & 0x00FF) == 0);
+    N = reg & 0x80;
+    Tick();
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::LD(byte &reg, byte operand)
+{
+    reg = operand;
+    SetZN(reg);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+byte Core<Bus, Trace, Timing, ISA>::LSR(byte operand)
+{
+    C = operand & 0x01;
+    N = 0;
+    byte temp = (hword)operand >> 1;
+    Z = (temp == 0);
+    Tick();
+    return temp & 0x7F;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::ORA(byte operand)
+{
+    A = A | operand;
+    Z = ((A & 0x00ff) == 0);
+    N = A & 0x80;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+byte Core<Bus, Trace, Timing, ISA>::ROL(byte operand)
+{
+    hword temp = (operand << 1) | C;   // Rotate the old carry in
+    C = (temp > 255);
+    Z = ((temp & 0x00FF) == 0);
+    N = temp & 0x80;
+    Tick();
+    return (byte)temp;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+byte Core<Bus, Trace, Timing, ISA>::ROR(byte operand)
+{
+    byte temp = (operand >> 1) | (C << 7);  // Rotate the old carry in
+    C = operand & 1;
+    Z = ((temp & 0x00ff) == 0);
+    N = temp & 0x80;
+    Tick();
+    return temp;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::SBC(byte operand)
+{
+    ADC(~operand + 1);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::STA(hword address)
+{
+    WriteByte(address, A);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::STX(hword address)
+{
+    WriteByte(address, X);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::STY(hword address)
+{
+    WriteByte(address, Y);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::DCP(hword address) //
+{
+    byte operand = ReadByte(address);
+    hword temp = (hword)operand - 1;
+    C = (temp > 255);
+    Z = ((temp & 0x00ff) == 0);
+    N = temp & 0x80;
+    V = (~((hword)A ^ (hword)operand) & ((hword)A ^ (hword)temp) & 0x0080);
+    operand = temp;
+    Compare(A, operand);
+    WriteByte(address, operand);
+    Tick(2);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::ISC(hword address) //
+{
+    byte operand = ReadByte(address);
+    hword temp = (hword)operand + 1;
+    A = A - operand - !C;
+    C = (temp > 255);
+    Z = ((temp & 0x00FF) == 0);
+    N = temp & 0x80;
+    V = (~((hword)A ^ (hword)operand) & ((hword)A ^ (hword)temp) & 0x0080);
+    operand = temp;
+    Compare(A, operand);
+    WriteByte(address, operand);
+    Tick(2);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::RLA(hword address)
+{
+    byte operand = ReadByte(address);
+    hword temp = (hword)operand << 1;
+    C = (temp > 255);
+    temp = (temp & 0xFE) | C;
+    Z = ((temp & 0x00FF) == 0);
+    N = temp & 0x80;
+    operand = (byte)temp;
+    A = A & operand;
+    WriteByte(address, operand);
+    Tick(2);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::RRA(hword address)
+{
+    byte operand = ReadByte(address);
+    C = operand & 0x01;
+    byte temp = operand >> 1;
+    temp = (temp & 0x7F) & (C << 7);
+    A = A + operand +  C;
+    Z = ((temp & 0x00FF) == 0);
+    N = temp & 0x80;
+    V = (~((hword)A ^ (hword)operand) & ((hword)A ^ (hword)temp) & 0x0080);
+    WriteByte(address, operand);
+    Tick(2);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::SAX(hword address)
+{
+    WriteByte(address, A & X);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::SLO(hword address)
+{
+    byte operand = ReadByte(address);
+    hword temp = (hword)operand << 1;
+    temp &= 0xFFFE;
+    C = (temp >> 7) & 0x0001;
+    Z = ((temp & 0x00FF) == 0);
+    N = temp & 0x80;
+    Tick();
+    byte result = temp & 0x00FF;
+    WriteByte(address, result);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::SRE(hword address)
+{
+    byte operand = ReadByte(address);
+    C = operand & 0x01;
+    operand >>= 1;
+    operand &= 0x7F;
+    Z = ((operand & 0x00ff) == 0);
+    N = operand & 0x80;
+    Tick();
+    WriteByte(address, operand);
+    A ^= operand;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+template <AddrMode M>
+byte Core<Bus, Trace, Timing, ISA>::Operand()
+{
+    if constexpr (M == AddrMode::Immediate || M == AddrMode::Relative)
+    {
+        return IM();
+    }
+    else if constexpr (M == AddrMode::Zeropage)
+    {
+        return ZP();
+    }
+    else if constexpr (M == AddrMode::ZeropageX)
+    {
+        return ZX();
+    }
+    else if constexpr (M == AddrMode::ZeropageY)
+    {
+        return ZY();
+    }
+    else if constexpr (M == AddrMode::Absolute)
+    {
+        return AB();
+    }
+    else if constexpr (M == AddrMode::AbsoluteX)
+    {
+        return AX();
+    }
+    else if constexpr (M == AddrMode::AbsoluteY)
+    {
+        return AY();
+    }
+    else if constexpr (M == AddrMode::IndirectX)
+    {
+        return IX();
+    }
+    else if constexpr (M == AddrMode::IndirectY)
+    {
+        return IY();
+    }
+    else
+    {
+        static_assert(M == AddrMode::Accumulator, "No operand in this addressing mode");
+        return A;
+    }
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+template <AddrMode M>
+hword Core<Bus, Trace, Timing, ISA>::EffectiveAddress()
+{
+    if constexpr (M == AddrMode::Zeropage)
+    {
+        return ZP_A();
+    }
+    else if constexpr (M == AddrMode::ZeropageX)
+    {
+        return ZX_A();
+    }
+    else if constexpr (M == AddrMode::ZeropageY)
+    {
+        return ZY_A();
+    }
+    else if constexpr (M == AddrMode::Absolute)
+    {
+        return AB_A();
+    }
+    else if constexpr (M == AddrMode::AbsoluteX)
+    {
+        Tick();     // Writes always spend the cycle a read only spends on a page crossing
+        return AX_A();
+    }
+    else if constexpr (M == AddrMode::AbsoluteY)
+    {
+        Tick();
+        return AY_A();
+    }
+    else if constexpr (M == AddrMode::IndirectX)
+    {
+        return IX_A();
+    }
+    else
+    {
+        static_assert(M == AddrMode::IndirectY, "No address in this addressing mode");
+        return IY_A();
+    }
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+template <Operation Op, AddrMode M>
+void Core<Bus, Trace, Timing, ISA>::Execute()
+{
+    // Read-modify-write operations share the same shape: on the
+    // accumulator, or loaded from and stored back to the effective address
+    constexpr bool accumulator = (M == AddrMode::Accumulator);
+
+    // **** Loads, arithmetic and logic ****
+
+    if constexpr (Op == Operation::ADC)
+    {
+        ADC(Operand<M>());
+    }
+    else if constexpr (Op == Operation::AND)
+    {
+        AND(Operand<M>());
+    }
+    else if constexpr (Op == Operation::BIT)
+    {
+        BIT(Operand<M>());
+    }
+    else if constexpr (Op == Operation::CMP)
+    {
+        CMP(Operand<M>());
+    }
+    else if constexpr (Op == Operation::CPX)
+    {
+        CPX(Operand<M>());
+    }
+    else if constexpr (Op == Operation::CPY)
+    {
+        CPY(Operand<M>());
+    }
+    else if constexpr (Op == Operation::EOR)
+    {
+        EOR(Operand<M>());
+    }
+    else if constexpr (Op == Operation::LDA)
+    {
+        if constexpr (M == AddrMode::IndirectY)
+        {
+            if (FuseLoop<true>())
+            {
+                return;
+            }
+        }
+        A = Operand<M>();
+        SetZN(A);
+    }
+    else if constexpr (Op == Operation::LDX)
+    {
+        LD(X, Operand<M>());
+    }
+    else if constexpr (Op == Operation::LDY)
+    {
+        LD(Y, Operand<M>());
+    }
+    else if constexpr (Op == Operation::ORA)
+    {
+        ORA(Operand<M>());
+    }
+    else if constexpr (Op == Operation::SBC)
+    {
+        SBC(Operand<M>());
+    }
+
+    // **** Stores ****
+
+    else if constexpr (Op == Operation::STA)
+    {
+        if constexpr (M == AddrMode::IndirectY)
+        {
+            if (FuseLoop<false>())
+            {
+                return;
+            }
+        }
+        STA(EffectiveAddress<M>());
+    }
+    else if constexpr (Op == Operation::STX)
+    {
+        STX(EffectiveAddress<M>());
+    }
+    else if constexpr (Op == Operation::STY)
+    {
+        STY(EffectiveAddress<M>());
+    }
+
+    // **** Read-modify-write ****
+
+    else if constexpr (Op == Operation::ASL)
+    {
+        if constexpr (accumulator)
+        {
+            ASL(A);
+        }
+        else
+        {
+            hword address = EffectiveAddress<M>();
+            WriteByte(address, ShiftLeft(ReadByte(address)));
+        }
+    }
+    else if constexpr (Op == Operation::LSR || Op == Operation::ROL || Op == Operation::ROR)
+    {
+        auto shift = [this](byte operand)
+        {
+            if constexpr (Op == Operation::LSR)
+            {
+                return LSR(operand);
+            }
+            else if constexpr (Op == Operation::ROL)
+            {
+                return ROL(operand);
+            }
+            else
+            {
+                return ROR(operand);
+            }
+        };
+        if constexpr (accumulator)
+        {
+            A = shift(A);
+        }
+        else
+        {
+            hword address = EffectiveAddress<M>();
+            WriteByte(address, shift(ReadByte(address)));
+        }
+    }
+    else if constexpr (Op == Operation::DEC || Op == Operation::INC)
+    {
+        hword address = EffectiveAddress<M>();
+        byte operand = ReadByte(address);
+        if constexpr (Op == Operation::DEC)
+        {
+            Decrement(operand);
+        }
+        else
+        {
+            Increment(operand);
+        }
+        WriteByte(address, operand);
+    }
+
+    // **** Registers ****
+
+    else if constexpr (Op == Operation::DEX)
+    {
+        Decrement(X);
+    }
+    else if constexpr (Op == Operation::DEY)
+    {
+        Decrement(Y);
+    }
+    else if constexpr (Op == Operation::INX)
+    {
+        Increment(X);
+    }
+    else if constexpr (Op == Operation::INY)
+    {
+        Increment(Y);
+    }
+    else if constexpr (Op == Operation::TAX || Op == Operation::TAY || Op == Operation::TSX ||
+                       Op == Operation::TXA || Op == Operation::TYA)
+    {
+        byte& to = (Op == Operation::TAX || Op == Operation::TSX) ? X :
+                   (Op == Operation::TAY) ? Y : A;
+        byte from = (Op == Operation::TAX || Op == Operation::TAY) ? A :
+                    (Op == Operation::TSX) ? (byte)SP :
+                    (Op == Operation::TXA) ? X : Y;
+        to = from;
+        SetZN(to);
+        Tick();
+    }
+    else if constexpr (Op == Operation::TXS)
+    {
+        SP = X;
+        Tick();
+    }
+
+    // **** Flags ****
+
+    else if constexpr (Op == Operation::CLC || Op == Operation::SEC)
+    {
+        C = (Op == Operation::SEC);
+        Tick();
+    }
+    else if constexpr (Op == Operation::CLD || Op == Operation::SED)
+    {
+        D = (Op == Operation::SED);
+        Tick();
+    }
+    else if constexpr (Op == Operation::CLI || Op == Operation::SEI)
+    {
+        I = (Op == Operation::SEI);
+        Tick();
+    }
+    else if constexpr (Op == Operation::CLV)
+    {
+        V = 0;
+        Tick();
+    }
+
+    // **** Branches and jumps ****
+
+    else if constexpr (Op == Operation::BCC || Op == Operation::BCS)
+    {
+        TakeBranch(C == (Op == Operation::BCS));
+    }
+    else if constexpr (Op == Operation::BEQ || Op == Operation::BNE)
+    {
+        TakeBranch(Z == (Op == Operation::BEQ));
+    }
+    else if constexpr (Op == Operation::BMI || Op == Operation::BPL)
+    {
+        TakeBranch(N == (Op == Operation::BMI));
+    }
+    else if constexpr (Op == Operation::BVC || Op == Operation::BVS)
+    {
+        TakeBranch(V == (Op == Operation::BVS));
+    }
+    else if constexpr (Op == Operation::JMP)
+    {
+        hword address = AB_A();
+        if constexpr (M == AddrMode::Indirect)
+        {
+            // The pointer's high byte never crosses into the next page
+            byte low = ReadByte(address);
+            byte high = ReadByte((address & 0xFF00) | ((address + 1) & 0x00FF));
+            address = ((hword)high << 8) | (hword)low;
+        }
+        PC = address;
+    }
+    else if constexpr (Op == Operation::JSR)
+    {
+        // The return address pushed is the last byte of the instruction
+        byte low = FetchInstruction();
+        Push((byte)(PC >> 8));
+        Push((byte)(PC & 0xFF));
+        Tick();
+        byte high = FetchInstruction();
+        PC = ((hword)high << 8) | (hword)low;
+        if (hooks && hooks->pages[PC >> 8]) [[unlikely]]
+            CallHook();
+    }
+    else if constexpr (Op == Operation::RTS)
+    {
+        byte low = Pull();
+        byte high = Pull();
+        PC = (((hword)high << 8) | (hword)low) + 1;
+        Tick(3);
+    }
+    else if constexpr (Op == Operation::BRK)
+    {
+        IM();   // Padding byte
+        Push((byte)(PC >> 8));
+        Push((byte)(PC & 0xFF));
+        Push(Status() | 0x30);
+        I = 1;
+        PC = ReadVector(0xFFFE);
+    }
+    else if constexpr (Op == Operation::RTI)
+    {
+        SetStatus(Pull());
+        byte low = Pull();
+        byte high = Pull();
+        PC = ((hword)high << 8) | (hword)low;
+        Tick(2);
+    }
+
+    // **** Stack ****
+
+    else if constexpr (Op == Operation::PHA)
+    {
+        Push(A);
+        Tick();
+    }
+    else if constexpr (Op == Operation::PHP)
+    {
+        Push(Status() | 0x30);
+        Tick();
+    }
+    else if constexpr (Op == Operation::PLA)
+    {
+        A = Pull();
+        SetZN(A);
+        Tick(2);
+    }
+    else if constexpr (Op == Operation::PLP)
+    {
+        SetStatus(Pull());
+        Tick(2);
+    }
+
+    // **** No operation ****
+
+    else if constexpr (Op == Operation::NOP)
+    {
+        if constexpr (M == AddrMode::Implied)
+        {
+            Tick();
+        }
+        else
+        {
+            Operand<M>();
+        }
+    }
+
+    // **** Illegal opcodes ****
+
+    else if constexpr (Op == Operation::ALR)
+    {
+        byte operand = IM();
+        operand &= A;
+        hword temp = (hword)operand << 1;
+        if (temp > 255)
+        {
+            C = 1;
+        }
+        if ((temp & 0x00ff) == 0)
+        {
+            Z = 1;
+        }
+        A = temp;
+        N = A & 0x80;
+    }
+    else if constexpr (Op == Operation::ANC)
+    {
+        byte operand = IM();
+        A &= operand;
+        C = (A & 0x80) >> 7; 
+        if (A == 0)
+        {
+            Z = 1;
+        }
+        N = A & 0x80;
+    }
+    else if constexpr (Op == Operation::ANE)
+    {
+        byte operand = IM();
+        A = (A | 0xFF) & X & operand;
+        if (A == 0)
+        {
+            Z = 1;
+        }
+        N = A & 0x80;
+    }
+    else if constexpr (Op == Operation::ARR)
+    {
+        byte operand = IM();
+        hword temp = ((hword)A & (hword)operand) + (hword)A;
+        V = (~((hword)A ^ (hword)operand) & ((hword)A ^ (hword)temp) & 0x0080);
+        if (A == 0)
+        {
+            Z = 1;
+        }
+        N = A & 0x80;
+        byte C_temp = (A & 0x80) >> 7;
+        temp &= 0xFF7F;
+        byte C_old = C << 7;
+        temp |= C_old;
+        C = C_temp;
+        A = temp;
+    }
+    else if constexpr (Op == Operation::DCP)
+    {
+        DCP(EffectiveAddress<M>());
+    }
+    else if constexpr (Op == Operation::ISC)
+    {
+        ISC(EffectiveAddress<M>());
+    }
+    else if constexpr (Op == Operation::LAS)
+    {
+        byte operand = Operand<M>();
+        A = operand & SP;
+        X = SP = A;
+        if (A == 0)
+        {
+            Z = 1;
+        }
+        N = A & 0x80;
+    }
+    else if constexpr (Op == Operation::LAX)
+    {
+        A = X = Operand<M>();
+        SetZN(A);
+    }
+    else if constexpr (Op == Operation::LXA)
+    {
+        byte operand = IM();
+        X = A = (A | 0xFF) & operand;
+        if (A == 0)
+        {
+            Z = 1;
+        }
+        N = A & 0x80;
+    }
+    else if constexpr (Op == Operation::RLA)
+    {
+        RLA(EffectiveAddress<M>());
+    }
+    else if constexpr (Op == Operation::RRA)
+    {
+        RRA(EffectiveAddress<M>());
+    }
+    else if constexpr (Op == Operation::SAX)
+    {
+        SAX(EffectiveAddress<M>());
+    }
+    else if constexpr (Op == Operation::SBX)
+    {
+        byte operand = IM();
+        hword temp = (hword)(A & X) - operand;
+        C = (temp & 0x80) >> 7; 
+        if (temp == 0)
+        {
+            Z = 1;
+        }
+        N = temp & 0x80;
+        X = temp;
+    }
+    else if constexpr (Op == Operation::SHA || Op == Operation::SHX || Op == Operation::SHY)
+    {
+        // Store the register AND (high byte of the address + 1)
+        hword address = EffectiveAddress<M>();
+        byte value = (Op == Operation::SHA) ? (A & X) : (Op == Operation::SHX) ? X : Y;
+        WriteByte(address, value & (((address >> 8) + 1) & 0xFF));
+    }
+    else if constexpr (Op == Operation::SLO)
+    {
+        SLO(EffectiveAddress<M>());
+    }
+    else if constexpr (Op == Operation::SRE)
+    {
+        SRE(EffectiveAddress<M>());
+    }
+    else if constexpr (Op == Operation::TAS)
+    {
+        hword address = EffectiveAddress<M>();
+        SP = A & X;
+        byte result = SP & (((address >> 15) & 0x01) + 1);
+        Tick();
+        WriteByte(address, result);
+    }
+    else if constexpr (Op == Operation::USBC)
+    {
+        byte operand = IM();
+        hword temp = (hword)A - (hword)operand - (hword)(!C);
+        if (temp > 255)
+        {
+            C = 1;
+        }
+        if ((temp & 0x00ff) == 0)
+        {
+            Z = 1;
+        }
+        N = temp & 0x80;
+        V = (~((hword)A ^ (hword)operand) & ((hword)A ^ (hword)temp) & 0x0080);
+        A = temp & 0x00FF;
+    }
+    else if constexpr (Op == Operation::JAM)
+    {
+        // The processor locks up on the opcode: stay on it and
+        // give up the rest of the cycles instead of hanging the host
+        if (Hypercall())
+            return;
+        PC--;
+        Stall();
+    }
+    else
+    {
+        static_assert(Op == Operation::Undefined, "Operation without a handler");
+        if (!Hypercall())
+            Stall();
+    }
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+template <Operation Op, AddrMode M>
+void Core<Bus, Trace, Timing, ISA>::Handle(Core& cpu)
+{
+    cpu.template Execute<Op, M>();
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+template <std::size_t... Opcodes>
+constexpr std::array<typename Core<Bus, Trace, Timing, ISA>::Handler, 256>
+Core<Bus, Trace, Timing, ISA>::MakeHandlers(std::index_sequence<Opcodes...>)
+{
+    // Opcodes left out by the instruction set get the undefined handler
+    return {{ (ISA::Implements(Opcodes)
+        ? &Handle<opcode_table[Opcodes].operation, opcode_table[Opcodes].mode>
+        : &Handle<Operation::Undefined, AddrMode::Implied>)... }};
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+constexpr std::array<typename Core<Bus, Trace, Timing, ISA>::Handler, 256>
+Core<Bus, Trace, Timing, ISA>::handlers = MakeHandlers(std::make_index_sequence<256>{});
+
+// Copy and fill loops are the hottest code in most firmware:
+//   loop: LDA (src),Y / STA (dst),Y / INY / BNE loop
+//   loop: STA (dst),Y / INY / BNE loop
+// When one starts at the current instruction (PC is just past its opcode),
+// the whole loop runs as a bulk copy or fill, leaving registers, flags,
+// memory and cycles exactly as interpreting it would. Loops that could
+// behave differently are left to the interpreter: when the run is not
+// cycle-bounded or is traced, when an event is pending, when the budget
+// would run out inside the loop, when the writes reach the loop's code or
+// pointers (through any mirror of the bus), or when devices are involved
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+template <bool Copy>
+bool Core<Bus, Trace, Timing, ISA>::FuseLoop()
+{
+    if constexpr (!Timing::counts || !std::is_same_v<Trace, NoTrace>)
+    {
+        return false;
+    }
+    else
+    {
+        if (!fuse || pending)
+        {
+            return false;
+        }
+
+        // Match the idiom
+        hword start = PC - 1;
+        hword store = Copy ? start + 2 : start;
+        hword end = store + 5;
+        if ((Copy && memory[store] != STA_IY) || memory[store + 2] != INY || memory[store + 3] != BNE ||
+            memory[store + 4] != (byte)(start - end))
+        {
+            return false;
+        }
+        byte source_pointer = memory[start + 1];
+        byte destination_pointer = memory[store + 1];
+        hword source = memory[source_pointer] | (memory[(byte)(source_pointer + 1)] << 8);
+        hword destination = memory[destination_pointer] | (memory[(byte)(destination_pointer + 1)] << 8);
+        word count = 256 - Y;
+
+        // Cycles, from the opcode table: LDA (zp),Y 5 plus 1 on a page
+        // crossing, STA (zp),Y 6, INY 2, BNE 2 plus 1 when taken and 1 more
+        // when that crosses a page. The first opcode fetch is already paid
+        sword total = ((Copy ? 5 : 0) + 6 + 2 + 2) * count + (count - 1) - 1;
+        if ((hword)(end + (std::int8_t)memory[store + 4]) >> 8 != end >> 8)
+        {
+            total += count - 1;
+        }
+        if (Copy && (source & 0xFF) != 0)
+        {
+            word first_crossing = std::max<word>(Y, 256 - (source & 0xFF));
+            total += 256 - first_crossing;
+        }
+        if (total > cycles)
+        {
+            return false;
+        }
+
+        // Writes must not change the loop while it runs, mirrors included
+        hword first = destination + Y;
+        auto written = [first, count](hword address)
+        {
+            return (word)(hword)((address - first) & Bus::ADDRESS_MASK) < count;
+        };
+        for (hword address = start; address != end; address++)
+        {
+            if (written(address))
+            {
+                return false;
+            }
+        }
+        if (written(source_pointer) || written((byte)(source_pointer + 1)) ||
+            written(destination_pointer) || written((byte)(destination_pointer + 1)))
+        {
+            return false;
+        }
+        if constexpr (requires { memory.HasDevices(first, count); })
+        {
+            if (memory.HasDevices(first, count) || (Copy && memory.HasDevices(source + Y, count)))
+            {
+                return false;
+            }
+        }
+
+        if constexpr (Copy)
+        {
+            if constexpr (requires { memory.Copy(first, source, count); })
+            {
+                memory.Copy(first, source + Y, count);
+            }
+            else
+            {
+                for (word i = 0; i < count; i++)
+                {
+                    memory.WriteByte(first + i, memory[source + Y + i]);
+                }
+            }
+            A = memory[(hword)(source + 255)];
+        }
+        else
+        {
+            if constexpr (requires { memory.Fill(first, A, count); })
+            {
+                memory.Fill(first, A, count);
+            }
+            else
+            {
+                for (word i = 0; i < count; i++)
+                {
+                    memory.WriteByte(first + i, A);
+                }
+            }
+        }
+        Y = 0;
+        Z = true;
+        N = false;
+        PC = end;
+        Tick(total);
+        fused_loops++;
+        return true;
+    }
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+template <typename Proceed>
+void Core<Bus, Trace, Timing, ISA>::run(Proceed proceed)
+{
+    while (proceed())
+    {
+        // Entering an interrupt counts as a step of its own
+        if (pending && Service()) [[unlikely]]
+        {
+            continue;
+        }
+        trace.Instruction(*this);
+        byte instruction = FetchInstruction();
+        handlers[instruction](*this);
+    }
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+template <typename Slice>
+void Core<Bus, Trace, Timing, ISA>::RunSlices(Slice slice) requires Timing::counts
+{
+    // The budget past the deadline is held back, so each slice stops there.
+    // Deadlines moved during the run are caught by Service
+    timed = true;
+    while (true)
+    {
+        HoldBack();
+        slice();
+        GiveBack();
+
+        if (elapsed() < deadline)
+        {
+            break;
+        }
+        UpdateEvents();
+    }
+    timed = false;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+template <typename Proceed>
+void Core<Bus, Trace, Timing, ISA>::RunTimed(Proceed proceed) requires Timing::counts
+{
+    RunSlices([this, &proceed] { run(proceed); });
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+void Core<Bus, Trace, Timing, ISA>::execute(hword init_addr) requires Timing::counts
+{
+    PC = init_addr;
+    fuse = true;
+    RunTimed([this] { return cycles > 0; });
+    fuse = false;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+word Core<Bus, Trace, Timing, ISA>::run_for_cycles(word n_cycles) requires Timing::counts
+{
+    // Cycles overshot by the last instruction of the previous call are
+    // still owed, so the slices add up to the same total as one long run
+    cycles += n_cycles;
+    cycle_base += n_cycles;
+    sword start = cycles;
+    fuse = true;
+    RunTimed([this] { return cycles > 0; });
+    fuse = false;
+    return start - cycles;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+word Core<Bus, Trace, Timing, ISA>::run_translated(Translation translation, word n_cycles) requires Timing::counts
+{
+    // Same bookkeeping as run_for_cycles. The translation hands back control
+    // on every event, and code it does not cover is interpreted one
+    // instruction at a time
+    cycles += n_cycles;
+    cycle_base += n_cycles;
+    sword start = cycles;
+    fuse = true;
+    RunSlices([this, translation] {
+        while (cycles > 0)
+        {
+            if (pending && Service()) [[unlikely]]
+            {
+                continue;
+            }
+            if (!translation(*this))
+            {
+                trace.Instruction(*this);
+                byte instruction = FetchInstruction();
+                handlers[instruction](*this);
+            }
+        }
+    });
+    fuse = false;
+    return start - cycles;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+word Core<Bus, Trace, Timing, ISA>::run_for_instructions(word n_instructions)
+{
+    sword start = cycles;
+    run([&n_instructions] { return n_instructions-- > 0; });
+
+    // Timed events are caught up with afterwards
+    if constexpr (Timing::counts)
+    {
+        if (elapsed() >= deadline)
+        {
+            UpdateEvents();
+        }
+    }
+    return start - cycles;
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+word Core<Bus, Trace, Timing, ISA>::step()
+{
+    return run_for_instructions(1);
+}
+
+template <typename Bus, typename Trace, typename Timing, typename ISA>
+bool Core<Bus, Trace, Timing, ISA>::run_until(hword address, word max_cycles) requires Timing::counts
+{
+    cycles += max_cycles;
+    cycle_base += max_cycles;
+    RunTimed([this, address] { return cycles > 0 && PC != address; });
+
+    // Hand back the budget left over when stopping early
+    if (PC == address && cycles > 0)
+    {
+        cycle_base -= cycles;
+        cycles = 0;
+    }
+    return PC == address;
+}
\ No newline at end of file
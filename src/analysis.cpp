@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+
+#ifndef ANALYSIS_h
+    #include "analysis.hpp"
+    #define ANALYSIS_h
+#endif
+
+#ifndef MEMORY_h
+    #include "memory.hpp"
+    #define MEMORY_h
+#endif
+
+namespace
+{
+    // Image bytes by address
+    struct View
+    {
+        std::span<const byte> image;
+        hword origin;
+
+        bool Holds(hword address, word length) const
+        {
+            return (word)(hword)(address - origin) + length <= image.size();
+        }
+        byte operator[](hword address) const { return image[(hword)(address - origin)]; }
+    };
+}
+
+std::vector<Decoded> FindCode(std::span<const byte> image, hword origin, hword entry)
+{
+    hword entries[] = { entry };
+    return FindCode(image, origin, entries);
+}
+
+std::vector<Decoded> FindCode(std::span<const byte> image, hword origin, std::span<const hword> entries)
+{
+    View view { image, origin };
+    std::bitset<MEM_SIZE> seen;
+    std::vector<hword> work(entries.rbegin(), entries.rend());
+    std::vector<Decoded> code;
+
+    while (!work.empty())
+    {
+        hword address = work.back();
+        work.pop_back();
+
+        // Follow the straight line until control leaves it for good
+        while (!seen[address] && view.Holds(address, 1))
+        {
+            byte opcode = view[address];
+            const OpcodeEntry& op = opcode_table[opcode];
+            if (op.operation == Operation::Undefined || !view.Holds(address, op.length))
+            {
+                break;
+            }
+            seen[address] = true;
+            hword next = address + op.length;
+            hword operand = op.length > 1 ? view[(hword)(address + 1)] : 0;
+            if (op.length == 3)
+            {
+                operand |= (hword)view[(hword)(address + 2)] << 8;
+            }
+
+            bool transfers = true;
+            bool goes_on = false;
+            hword target = next;
+            switch (op.operation)
+            {
+                case Operation::BCC: case Operation::BCS: case Operation::BEQ: case Operation::BMI:
+                case Operation::BNE: case Operation::BPL: case Operation::BVC: case Operation::BVS:
+                    target = next + (std::int8_t)operand;
+                    work.push_back(target);
+                    goes_on = true;
+                    break;
+                case Operation::JSR:
+                    target = operand;
+                    work.push_back(target);
+                    goes_on = true;
+                    break;
+                case Operation::JMP:
+                    if (op.mode == AddrMode::Absolute)
+                    {
+                        target = operand;
+                        work.push_back(target);
+                    }
+                    break;
+                case Operation::RTS: case Operation::RTI: case Operation::BRK: case Operation::JAM:
+                    break;
+                default:
+                    transfers = false;
+                    goes_on = true;
+            }
+            code.push_back({ address, opcode, transfers, target });
+            if (!goes_on)
+            {
+                break;
+            }
+            address = next;
+        }
+    }
+
+    std::sort(code.begin(), code.end(), [](const Decoded& a, const Decoded& b) { return a.address < b.address; });
+    return code;
+}
+
+
+std::vector<BasicBlock> FindBlocks(std::span<const Decoded> code, const Profile* profile)
+{
+    auto next_of = [](const Decoded& instruction) { return (hword)(instruction.address + opcode_table[instruction.opcode].length); };
+
+    std::vector<bool> leader(MEM_SIZE);
+    for (const Decoded& instruction: code)
+    {
+        if (instruction.transfers)
+        {
+            leader[instruction.target] = true;
+            leader[next_of(instruction)] = true;
+        }
+        if (profile && profile->entries[instruction.address])
+        {
+            leader[instruction.address] = true;
+        }
+    }
+
+    std::vector<BasicBlock> blocks;
+    for (std::size_t i = 0; i < code.size(); i++)
+    {
+        bool follows = i > 0 && !leader[code[i].address] && !code[i - 1].transfers
+            && next_of(code[i - 1]) == code[i].address;
+        if (!follows)
+        {
+            blocks.push_back({ i, i, code[i].address, code[i].address, {} });
+        }
+        blocks.back().end = i + 1;
+        blocks.back().last = code[i].address;
+    }
+
+    // Successors: the destination and where falling through or returning leads
+    for (BasicBlock& block: blocks)
+    {
+        const Decoded& last = code[block.end - 1];
+        Operation operation = opcode_table[last.opcode].operation;
+        bool dead_end = operation == Operation::RTS || operation == Operation::RTI
+            || operation == Operation::BRK || operation == Operation::JAM
+            || (operation == Operation::JMP && opcode_table[last.opcode].mode == AddrMode::Indirect);
+        if (dead_end)
+        {
+            continue;
+        }
+        block.successors.push_back(last.target);
+        if (operation != Operation::JMP && last.target != next_of(last))
+        {
+            block.successors.push_back(next_of(last));
+        }
+    }
+    return blocks;
+}
+
+std::vector<byte> CodeMap::WrittenPages(const Memory& memory) const
+{
+    std::vector<byte> written;
+    for (word page = 0; page < Memory::PAGES; page++)
+    {
+        if (pages[page] && memory.Written(page))
+        {
+            written.push_back(page);
+        }
+    }
+    return written;
+}
+
+void CodeMap::Print(std::FILE* out, hword origin, word size) const
+{
+    for (const BasicBlock& block: blocks)
+    {
+        std::fprintf(out, "code $%04X-$%04X (%zu)", block.first, block.last, block.end - block.begin);
+        for (hword successor: block.successors)
+        {
+            std::fprintf(out, " $%04X", successor);
+        }
+        std::fprintf(out, "\n");
+    }
+
+    // Data: the image bytes no instruction covers
+    for (word offset = 0; offset < size; )
+    {
+        if (bytes[(hword)(origin + offset)])
+        {
+            offset++;
+            continue;
+        }
+        word start = offset;
+        while (offset < size && !bytes[(hword)(origin + offset)])
+        {
+            offset++;
+        }
+        std::fprintf(out, "data $%04X-$%04X\n", (hword)(origin + start), (hword)(origin + offset - 1));
+    }
+}
+
+CodeMap MapCode(std::span<const byte> image, hword origin, hword entry)
+{
+    View view { image, origin };
+    CodeMap map;
+    map.entries = { entry };
+    for (hword vector: { 0xFFFA, 0xFFFC, 0xFFFE })
+    {
+        if (view.Holds(vector, 2))
+        {
+            map.entries.push_back(view[vector] | (hword)view[(hword)(vector + 1)] << 8);
+        }
+    }
+
+    map.code = FindCode(image, origin, map.entries);
+    map.blocks = FindBlocks(map.code);
+    for (const Decoded& instruction: map.code)
+    {
+        for (word i = 0; i < opcode_table[instruction.opcode].length; i++)
+        {
+            hword address = instruction.address + i;
+            map.bytes[address] = true;
+            map.pages[address >> 8] = true;
+        }
+    }
+    return map;
+}
@@ -0,0 +1,74 @@
+#include <bitset>
+#include <cstdio>
+#include <span>
+#include <vector>
+
+#ifndef NUMBERS_h
+    #include "numbers.hpp"
+    #define NUMBERS_h
+#endif
+
+#ifndef OPCODES_h
+    #include "opcodes.hpp"
+    #define OPCODES_h
+#endif
+
+#ifndef PROFILE_h
+    #include "profile.hpp"
+    #define PROFILE_h
+#endif
+
+class Memory;
+
+// **** Code analysis ****
+// Which bytes of a loaded image are code, found by following the program
+// from its entry points, and how the code splits into basic blocks. Used
+// by the recompiler, and by anything that has to tell code from data
+
+// Instruction reached from an entry point
+struct Decoded
+{
+    hword address;  // Address of the opcode
+    byte opcode;
+    bool transfers;     // May leave PC somewhere else than the next instruction
+    hword target;   // Destination of a branch, JMP or JSR; the next instruction otherwise
+};
+
+// Recursive traversal from the entry points through branches, JMP and JSR
+// (returns are expected after the JSR), in address order. The image is
+// loaded at origin; bytes outside of it are not code
+std::vector<Decoded> FindCode(std::span<const byte> image, hword origin, std::span<const hword> entries);
+std::vector<Decoded> FindCode(std::span<const byte> image, hword origin, hword entry);
+
+// Straight-line run of instructions, entered only at the top
+struct BasicBlock
+{
+    std::size_t begin;  // Index of the first instruction in the code
+    std::size_t end;    // Index past the last instruction
+    hword first;    // Address of the first instruction
+    hword last;     // Address of the last instruction
+    std::vector<hword> successors;  // Where control goes next, when known (after a JSR: the call and the return)
+};
+
+// Split code found by FindCode into blocks, in address order. Blocks start
+// at known destinations, after transfers and where the profile, if any,
+// saw control arrive
+std::vector<BasicBlock> FindBlocks(std::span<const Decoded> code, const Profile* profile = nullptr);
+
+// Code/data map of an image
+struct CodeMap
+{
+    std::vector<Decoded> code;  // Instructions, in address order
+    std::vector<BasicBlock> blocks;     // Basic blocks, in address order
+    std::vector<hword> entries;     // Where the code was followed from: the entry point, then the vectors held
+    std::bitset<MEM_SIZE> bytes;    // Opcodes and operands of the instructions
+    std::bitset<256> pages;     // Pages holding code
+
+    bool IsCode(hword address) const { return bytes[address]; }
+    std::vector<byte> WrittenPages(const Memory&) const;    // Code pages written or remapped since the memory's baseline
+    void Print(std::FILE* out, hword origin, word size) const;  // Blocks, and data ranges within the image
+};
+
+// Map the code reached from the entry point and from the NMI, reset and
+// IRQ vectors, when the image holds them
+CodeMap MapCode(std::span<const byte> image, hword origin, hword entry);
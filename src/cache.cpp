@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+
+#ifndef CACHE_h
+    #include "cache.hpp"
+    #define CACHE_h
+#endif
+
+namespace
+{
+    // File layout, little endian: header, entry points, then one record per instruction
+    //   "AF6502DC", version (4), key (8), origin (2), image size (4), entries (4), count (4)
+    //   entry (2)
+    //   address (2), opcode (1), transfers (1), target (2)
+    constexpr char magic[8] = { 'A', 'F', '6', '5', '0', '2', 'D', 'C' };
+    constexpr word version = 3;     // Bumped whenever FindCode's output changes
+    constexpr std::size_t header_size = 8 + 4 + 8 + 2 + 4 + 4 + 4;
+    constexpr std::size_t record_size = 6;
+
+    void Put(std::vector<byte>& out, dword value, int bytes)
+    {
+        for (int i = 0; i < bytes; i++)
+        {
+            out.push_back((byte)(value >> (8 * i)));
+        }
+    }
+
+    dword Get(const byte* in, int bytes)
+    {
+        dword value = 0;
+        for (int i = 0; i < bytes; i++)
+        {
+            value |= (dword)in[i] << (8 * i);
+        }
+        return value;
+    }
+}
+
+DecodeCache::DecodeCache(std::filesystem::path directory) : directory(std::move(directory))
+{
+}
+
+dword DecodeCache::Key(std::span<const byte> image, hword origin, hword entry)
+{
+    hword entries[] = { entry };
+    return Key(image, origin, entries);
+}
+
+dword DecodeCache::Key(std::span<const byte> image, hword origin, std::span<const hword> entries)
+{
+    dword hash = 0xCBF29CE484222325;
+    auto mix = [&hash](byte b) { hash = (hash ^ b) * 0x100000001B3; };
+    for (byte b: image)
+    {
+        mix(b);
+    }
+    mix(origin & 0xFF);
+    mix(origin >> 8);
+    for (hword entry: entries)
+    {
+        mix(entry & 0xFF);
+        mix(entry >> 8);
+    }
+    return hash;
+}
+
+std::filesystem::path DecodeCache::PathOf(dword key) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.decode", (unsigned long long)key);
+    return directory / name;
+}
+
+bool DecodeCache::Read(dword key, std::span<const byte> image, hword origin, std::span<const hword> entries, std::vector<Decoded>& code) const
+{
+    std::ifstream fin(PathOf(key), std::ios::binary);
+    std::vector<byte> file((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+    const byte* in = file.data();
+    if (file.size() < header_size
+        || !std::equal(std::begin(magic), std::end(magic), in)
+        || Get(in + 8, 4) != version
+        || Get(in + 12, 8) != key
+        || Get(in + 20, 2) != origin
+        || Get(in + 22, 4) != image.size()
+        || Get(in + 26, 4) != entries.size()
+        || file.size() != header_size + entries.size() * 2 + Get(in + 30, 4) * record_size)
+    {
+        return false;
+    }
+    for (std::size_t i = 0; i < entries.size(); i++)
+    {
+        if (Get(in + header_size + 2 * i, 2) != entries[i])
+        {
+            return false;
+        }
+    }
+
+    // Every instruction must still be the one in the image
+    code.clear();
+    for (const byte* record = in + header_size + entries.size() * 2; record < in + file.size(); record += record_size)
+    {
+        hword address = Get(record, 2);
+        word offset = (hword)(address - origin);
+        if (offset >= image.size() || image[offset] != record[2])
+        {
+            return false;
+        }
+        code.push_back({ address, record[2], record[3] != 0, (hword)Get(record + 4, 2) });
+    }
+    return true;
+}
+
+void DecodeCache::Write(dword key, std::span<const byte> image, hword origin, std::span<const hword> entries, std::span<const Decoded> code) const
+{
+    std::vector<byte> out(std::begin(magic), std::end(magic));
+    Put(out, version, 4);
+    Put(out, key, 8);
+    Put(out, origin, 2);
+    Put(out, image.size(), 4);
+    Put(out, entries.size(), 4);
+    Put(out, code.size(), 4);
+    for (hword entry: entries)
+    {
+        Put(out, entry, 2);
+    }
+    for (const Decoded& instruction: code)
+    {
+        Put(out, instruction.address, 2);
+        Put(out, instruction.opcode, 1);
+        Put(out, instruction.transfers, 1);
+        Put(out, instruction.target, 2);
+    }
+
+    // A cache that cannot be written is only a slower cache
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    std::filesystem::path path = PathOf(key);
+    std::filesystem::path temporary = path;
+    temporary += ".tmp";
+    {
+        std::ofstream fout(temporary, std::ios::binary);
+        fout.write((const char*)out.data(), out.size());
+        if (fout.fail())
+        {
+            return;
+        }
+    }
+    std::filesystem::rename(temporary, path, error);
+}
+
+std::vector<Decoded> DecodeCache::FindCode(std::span<const byte> image, hword origin, hword entry)
+{
+    hword entries[] = { entry };
+    return FindCode(image, origin, entries);
+}
+
+std::vector<Decoded> DecodeCache::FindCode(std::span<const byte> image, hword origin, std::span<const hword> entries)
+{
+    dword key = Key(image, origin, entries);
+    std::vector<Decoded> code;
+    if (Read(key, image, origin, entries, code))
+    {
+        stats.hits++;
+        return code;
+    }
+    if (std::filesystem::exists(PathOf(key)))
+    {
+        stats.rejected++;
+    }
+    stats.misses++;
+    code = ::FindCode(image, origin, entries);
+    Write(key, image, origin, entries, code);
+    return code;
+}
+
+void DecodeCache::Report(std::FILE* out) const
+{
+    std::fprintf(out, "Decode cache: %u hits, %u misses (%u rejected)\n", stats.hits, stats.misses, stats.rejected);
+}
@@ -0,0 +1,48 @@
+#include <cstdio>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#ifndef NUMBERS_h
+    #include "numbers.hpp"
+    #define NUMBERS_h
+#endif
+
+#ifndef ANALYSIS_h
+    #include "analysis.hpp"
+    #define ANALYSIS_h
+#endif
+
+// **** Decode cache ****
+// Finding and decoding the code of an image is the same work on every run
+// of the same image, so the result is kept on disk: one file per image,
+// load address and entry points, named after their hash. A file is read
+// back in one piece and checked against the image, which costs a compare
+// per instruction instead of a traversal. Files that do not match are
+// replaced; files are written to a temporary name and renamed, so
+// concurrent runs never see half of one
+class DecodeCache
+{
+    private:
+    std::filesystem::path directory;    // Where the files live
+
+    std::filesystem::path PathOf(dword key) const;
+    bool Read(dword key, std::span<const byte> image, hword origin, std::span<const hword> entries, std::vector<Decoded>& code) const;
+    void Write(dword key, std::span<const byte> image, hword origin, std::span<const hword> entries, std::span<const Decoded> code) const;
+
+    public:
+    struct Stats
+    {
+        word hits = 0;  // Decodes read from the cache
+        word misses = 0;    // Decodes done and stored
+        word rejected = 0;  // Files that did not match their image (counted as misses too)
+    };
+    Stats stats;
+
+    explicit DecodeCache(std::filesystem::path directory);
+    static dword Key(std::span<const byte> image, hword origin, std::span<const hword> entries);   // 64-bit FNV-1a hash
+    static dword Key(std::span<const byte> image, hword origin, hword entry);
+    std::vector<Decoded> FindCode(std::span<const byte> image, hword origin, std::span<const hword> entries);  // ::FindCode, through the cache
+    std::vector<Decoded> FindCode(std::span<const byte> image, hword origin, hword entry);
+    void Report(std::FILE* out) const;  // Print the statistics
+};
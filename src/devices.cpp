@@ -0,0 +1,325 @@
+#include <algorithm>
+#include <stdexcept>
+
+#ifndef DEVICES_h
+    #include "devices.hpp"
+    #define DEVICES_h
+#endif
+
+BankMapper::BankMapper(hword window, word window_size, word banks, bool writable)
+    : window(window & 0xFF00), window_size(window_size), writable(writable), store(window_size * banks)
+{
+    if (banks == 0 || window_size == 0 || window_size % Memory::PAGE_SIZE != 0 ||
+        (window >> 8) + window_size / Memory::PAGE_SIZE > Memory::PAGES)
+    {
+        throw std::invalid_argument("BankMapper: no banks, or a window that is not whole pages of the address space");
+    }
+}
+
+void BankMapper::Load(std::span<const byte> data, word offset)
+{
+    word count = std::min<word>(data.size(), store.size() - std::min<word>(offset, store.size()));
+    std::copy_n(data.begin(), count, store.begin() + offset);
+}
+
+void BankMapper::Select(Memory& memory, byte bank)
+{
+    selected = bank % Banks();
+    shown = true;
+    byte* data = store.data() + (word)selected * window_size;
+    for (word i = 0; i < window_size / Memory::PAGE_SIZE; i++)
+    {
+        memory.MapPage((window >> 8) + i, data + i * Memory::PAGE_SIZE, writable);
+    }
+}
+
+byte BankMapper::Read(hword)
+{
+    return selected;
+}
+
+void BankMapper::Write(Memory& memory, hword, byte data)
+{
+    Select(memory, data);
+}
+
+void BankMapper::SetBaseline()
+{
+    baseline = shown ? selected : -1;
+}
+
+void BankMapper::Restore(Memory& memory)
+{
+    if (baseline >= 0)
+    {
+        Select(memory, baseline);
+    }
+    else
+    {
+        selected = 0;
+        shown = false;
+    }
+}
+
+Console::Console(std::FILE* out) : out(out)
+{
+    output.reserve(FLUSH_SIZE);
+}
+
+Console::~Console()
+{
+    Flush();
+}
+
+void Console::SetInput(std::string text)
+{
+    input = std::move(text);
+    next = 0;
+}
+
+void Console::ReadInput(std::FILE* in)
+{
+    this->in = in;
+}
+
+bool Console::Available()
+{
+    if (next < input.size())
+    {
+        return true;
+    }
+    if (in == nullptr)
+    {
+        return false;
+    }
+
+    // One line at a time, so a terminal only waits for the line being typed
+    Flush();
+    input.clear();
+    next = 0;
+    char buffer[4096];
+    if (std::fgets(buffer, sizeof(buffer), in) == nullptr)
+    {
+        in = nullptr;
+        return false;
+    }
+    input = buffer;
+    return true;
+}
+
+void Console::Flush()
+{
+    if (out != nullptr && !output.empty())
+    {
+        std::fwrite(output.data(), 1, output.size(), out);
+        std::fflush(out);
+        output.clear();
+    }
+}
+
+byte Console::Read(hword address)
+{
+    switch (address & 0xFF)
+    {
+        case DATA:
+            return Available() ? (byte)input[next++] : 0;
+        case STATUS:
+            return Available();
+        default:
+            return 0;
+    }
+}
+
+void Console::Write(Memory&, hword address, byte data)
+{
+    if ((address & 0xFF) == DATA)
+    {
+        output.push_back((char)data);
+        if (output.size() >= FLUSH_SIZE)
+        {
+            Flush();
+        }
+    }
+}
+
+Timer::Timer(CPUState& clock, word line) : clock(clock), line(line)
+{
+    clock.AddEventSource(this);
+}
+
+Timer::~Timer()
+{
+    clock.RemoveEventSource(this);
+    clock.ReleaseIrq(line);
+}
+
+void Timer::Rearm()
+{
+    if ((control & RUN) && (control & IRQ))
+    {
+        clock.Schedule(NextUnderflow());
+    }
+    else
+    {
+        clock.ReleaseIrq(line);
+    }
+}
+
+void Timer::Update(CPUState& cpu)
+{
+    if (Pending())
+    {
+        cpu.AssertIrq(line);
+    }
+    Rearm();
+}
+
+dword Timer::Underflows() const
+{
+    if (!(control & RUN))
+    {
+        return 0;
+    }
+    return (clock.elapsed() - start) / ((dword)reload + 1);
+}
+
+hword Timer::Count() const
+{
+    if (!(control & RUN))
+    {
+        return reload;
+    }
+    return reload - (clock.elapsed() - start) % ((dword)reload + 1);
+}
+
+bool Timer::Pending() const
+{
+    return (control & IRQ) && Underflows() > acknowledged;
+}
+
+dword Timer::NextUnderflow() const
+{
+    return start + (Underflows() + 1) * ((dword)reload + 1);
+}
+
+byte Timer::Read(hword address)
+{
+    switch (address & 0xFF)
+    {
+        case RELOAD_LOW:
+            return Count() & 0xFF;
+        case RELOAD_HIGH:
+            return Count() >> 8;
+        case CONTROL:
+            return control;
+        case STATUS:
+        {
+            dword underflows = Underflows();
+            bool flag = underflows > acknowledged;
+            acknowledged = underflows;
+            clock.ReleaseIrq(line);
+            return flag;
+        }
+        default:
+            return 0;
+    }
+}
+
+void Timer::Write(Memory&, hword address, byte data)
+{
+    switch (address & 0xFF)
+    {
+        case RELOAD_LOW:
+            reload = (reload & 0xFF00) | data;
+            break;
+        case RELOAD_HIGH:
+            reload = (reload & 0x00FF) | ((hword)data << 8);
+            start = clock.elapsed();
+            acknowledged = 0;
+            Rearm();
+            break;
+        case CONTROL:
+            if ((data & RUN) && !(control & RUN))
+            {
+                start = clock.elapsed();
+                acknowledged = 0;
+            }
+            control = data;
+            Rearm();
+            break;
+    }
+}
+
+DmaController::DmaController(CPUState& cpu) : cpu(cpu)
+{
+}
+
+byte DmaController::Read(hword address)
+{
+    return (address & 0xFF) < registers.size() ? registers[address & 0xFF] : 0;
+}
+
+void DmaController::Write(Memory& memory, hword address, byte data)
+{
+    if ((address & 0xFF) >= registers.size())
+    {
+        return;
+    }
+    registers[address & 0xFF] = data;
+    if ((address & 0xFF) != CONTROL)
+    {
+        return;
+    }
+
+    auto address_at = [this](byte index) { return (hword)(registers[index] | (registers[index + 1] << 8)); };
+    hword destination = address_at(DESTINATION);
+    word length = address_at(LENGTH);
+
+    // Writing over the controller's own registers would start transfers
+    // from inside this one: such a transfer is refused
+    hword own = address & 0xFF00;
+    if ((word)(hword)(own - destination) < length || (word)(hword)(destination - own) < Memory::PAGE_SIZE)
+    {
+        return;
+    }
+
+    if (data & FILL)
+    {
+        memory.Fill(destination, registers[VALUE], length);
+        cpu.Steal(FILL_CYCLES * length);
+    }
+    else
+    {
+        memory.Copy(destination, address_at(SOURCE), length);
+        cpu.Steal(COPY_CYCLES * length);
+    }
+}
+
+CycleMarker::CycleMarker(CPUState& clock, dword width, dword low) : clock(clock), histogram(width, low)
+{
+}
+
+byte CycleMarker::Read(hword)
+{
+    return 0;
+}
+
+void CycleMarker::Write(Memory&, hword address, byte)
+{
+    switch (address & 0xFF)
+    {
+        case START:
+            began = clock.elapsed();
+            inside = true;
+            break;
+        case STOP:
+            if (inside)
+            {
+                histogram.Add(clock.elapsed() - began);
+                inside = false;
+            }
+            break;
+        default:
+            break;
+    }
+}
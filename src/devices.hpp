@@ -0,0 +1,186 @@
+#include <array>
+#include <cstdio>
+#include <span>
+#include <string>
+#include <vector>
+
+#ifndef NUMBERS_h
+    #include "numbers.hpp"
+    #define NUMBERS_h
+#endif
+
+#ifndef MEMORY_h
+    #include "memory.hpp"
+    #define MEMORY_h
+#endif
+
+#ifndef CPU_h
+    #include "CPU.hpp"
+    #define CPU_h
+#endif
+
+#ifndef MEASURE_h
+    #include "measure.hpp"
+    #define MEASURE_h
+#endif
+
+// **** Devices ****
+// Attach them with Memory::Attach; they are shared by the copies of a Memory
+
+// Bank switching: a window of the address space shows one bank of a larger
+// store at a time. Writing a bank number to the control register switches
+// banks by remapping the window's pages; nothing is copied. Restoring the
+// memory's baseline selects the bank selected when it was recorded. There
+// must be at least one bank, and the window must be whole pages
+// (std::invalid_argument otherwise)
+class BankMapper : public Device
+{
+    private:
+    hword window;   // First address of the window, page aligned
+    word window_size;   // Bytes, a multiple of the page size (4, 8, 16 KiB...)
+    bool writable;  // RAM banks if true, ROM banks otherwise
+    std::vector<byte> store;    // All the banks, back to back
+    byte selected = 0;  // Bank shown in the window
+    bool shown = false;     // Window mapped to a bank
+    int baseline = -1;  // Bank shown when the memory's baseline was recorded (-1: none)
+
+    public:
+    BankMapper(hword window, word window_size, word banks, bool writable);
+    word Banks() const { return store.size() / window_size; }
+    byte Selected() const { return selected; }
+    void Load(std::span<const byte> data, word offset);     // Fill the store, from a byte offset
+    void Select(Memory& memory, byte bank);     // Show a bank in the window (modulo the bank count)
+    byte Read(hword address) override;  // Control register: selected bank
+    void Write(Memory& memory, hword address, byte data) override;  // Control register: select a bank
+    void SetBaseline() override;
+    void Restore(Memory& memory) override;  // Select the baseline's bank again
+};
+
+// Character console. Registers, from the start of its page:
+// - +0 data: writes append a character to the output, reads take the next
+//   input character (0 when there is none)
+// - +1 status: bit 0 is set while input is available
+// Output collects in a host buffer written out in bulk; input comes from
+// a string given ahead of time, or from a host stream read a line at a
+// time, only when the guest asks for input (the output is flushed first,
+// so prompts show)
+class Console : public Device
+{
+    private:
+    std::FILE* out;     // Where the output goes, nullptr: keep it in the buffer
+    std::FILE* in = nullptr;    // Host stream input is read from, nullptr: none (or at its end)
+    std::string output;     // Output not flushed yet
+    std::string input;  // Input not taken yet
+    std::size_t next = 0;   // Next input character
+
+    bool Available();   // Input left, reading more from the host stream when out
+
+    public:
+    static constexpr byte DATA = 0x00;
+    static constexpr byte STATUS = 0x01;
+    static constexpr std::size_t FLUSH_SIZE = 64 * 1024;   // Output buffered before a flush
+
+    explicit Console(std::FILE* out = stdout);
+    ~Console();
+    void SetInput(std::string text);    // Input for the guest
+    void ReadInput(std::FILE* in);  // Take the guest's input from a host stream, as it is asked for
+    const std::string& Output() const { return output; }    // Output not flushed yet
+    void Flush();   // Write the buffered output out
+    byte Read(hword address) override;
+    void Write(Memory& memory, hword address, byte data) override;
+};
+
+// Interval timer, counting down once per cycle of the core it was built
+// for and reloading on underflow. Registers, from the start of its page:
+// - +0, +1 reload value, low and high byte (writing the high byte restarts
+//   the count); reads return the current count
+// - +2 control: bit 0 runs the timer, bit 1 enables its interrupt
+// - +3 status: bit 0 is set after an underflow, reading clears it
+// Nothing is ticked: the count is worked out from the core's elapsed
+// cycles whenever it is read. With its interrupt enabled, the timer asks
+// the core for an event at the next underflow and holds its IRQ line until
+// the status register is read. It must not outlive the core, and it leaves
+// the core's event sources when it goes away
+class Timer : public Device, public EventSource
+{
+    private:
+    CPUState& clock;    // Core whose cycles drive the timer
+    word line;  // IRQ source bit
+    hword reload = 0xFFFF;  // Count loaded on start and on underflow
+    byte control = 0;   // Control register
+    dword start = 0;    // Cycle the count started at
+    dword acknowledged = 0;     // Underflows already reported
+
+    dword Underflows() const;   // Underflows since the start
+    void Rearm();   // Schedule the next underflow, or drop the IRQ line when disabled
+
+    public:
+    static constexpr byte RELOAD_LOW = 0x00;
+    static constexpr byte RELOAD_HIGH = 0x01;
+    static constexpr byte CONTROL = 0x02;
+    static constexpr byte STATUS = 0x03;
+    static constexpr byte RUN = 0x01;   // Control: timer running
+    static constexpr byte IRQ = 0x02;   // Control: interrupt on underflow
+
+    explicit Timer(CPUState& clock, word line = 0x01);
+    ~Timer() override;
+    hword Count() const;    // Current count
+    bool Pending() const;   // Underflowed with the interrupt enabled, not acknowledged yet
+    dword NextUnderflow() const;    // Cycle of the next underflow (elapsed time)
+    byte Read(hword address) override;
+    void Write(Memory& memory, hword address, byte data) override;
+    void Update(CPUState& cpu) override;    // Raise the IRQ on underflow, schedule the next one
+};
+
+// DMA controller. Registers, from the start of its page:
+// - +0, +1 source address; +2, +3 destination address; +4, +5 length
+// - +6 fill value
+// - +7 control: writing starts a transfer, a fill if bit 0 is set, a copy
+//   otherwise
+// The transfer is done at once with bulk copies, and the core is charged
+// the cycles the bus would have been busy. A transfer whose destination
+// covers the controller's own page is refused
+class DmaController : public Device
+{
+    private:
+    CPUState& cpu;  // Core whose cycles are stolen
+    std::array<byte, 8> registers {};   // Register file
+
+    public:
+    static constexpr byte SOURCE = 0x00;
+    static constexpr byte DESTINATION = 0x02;
+    static constexpr byte LENGTH = 0x04;
+    static constexpr byte VALUE = 0x06;
+    static constexpr byte CONTROL = 0x07;
+    static constexpr byte FILL = 0x01;  // Control: fill instead of copying
+    static constexpr sword COPY_CYCLES = 2;     // Per byte copied: one read, one write
+    static constexpr sword FILL_CYCLES = 1;     // Per byte filled
+
+    explicit DmaController(CPUState& cpu);
+    byte Read(hword address) override;
+    void Write(Memory& memory, hword address, byte data) override;
+};
+
+// Cycle measurement by magic stores. Registers, from the start of its page:
+// - +0 start: any write starts a pass
+// - +1 stop: any write ends the pass and counts it in the histogram
+// A pass runs from one store to the other, so it includes the cycles of
+// one of them; a stop without a start is not counted. Reads return 0.
+// It must not outlive the core
+class CycleMarker : public Device
+{
+    private:
+    CPUState& clock;    // Core whose cycles are counted
+    dword began = 0;    // Elapsed cycles at the start store
+    bool inside = false;    // In a pass
+
+    public:
+    static constexpr byte START = 0x00;
+    static constexpr byte STOP = 0x01;
+
+    CycleHistogram histogram;   // Passes so far
+
+    explicit CycleMarker(CPUState& clock, dword width = 1, dword low = 0);
+    byte Read(hword address) override;
+    void Write(Memory& memory, hword address, byte data) override;
+};
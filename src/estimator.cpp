@@ -0,0 +1,448 @@
+#include <algorithm>
+#include <fstream>
+#include <string>
+
+#ifndef ESTIMATOR_h
+    #include "estimator.hpp"
+    #define ESTIMATOR_h
+#endif
+
+namespace
+{
+    // Sums and products that stop at UNBOUNDED instead of wrapping
+    dword Sum(dword a, dword b)
+    {
+        return a > UNBOUNDED - b ? UNBOUNDED : a + b;
+    }
+
+    dword Times(dword n, dword cycles)
+    {
+        return n != 0 && cycles > UNBOUNDED / n ? UNBOUNDED : n * cycles;
+    }
+
+    // Node of a routine's graph: a block, or a collapsed loop in place of its head
+    struct Edge
+    {
+        int from;
+        int to;
+        dword cost;     // Cycles from entering the source to entering the destination
+    };
+
+    class Estimator
+    {
+        private:
+        std::span<const byte> image;
+        hword origin;
+        const CodeMap& map;
+        const LoopBounds& bounds;
+        std::vector<int> block_at = std::vector<int>(MEM_SIZE, -1);     // Block starting at each address
+        std::map<hword, dword> routines;    // Done so far
+        std::vector<hword> calling;     // Routines being estimated, for recursion
+
+        byte Byte(hword address) const
+        {
+            word offset = (hword)(address - origin);
+            return offset < image.size() ? image[offset] : 0;
+        }
+
+        public:
+        std::vector<dword> base;    // Cycles of a block, without the extra cycles of a taken branch
+
+        Estimator(std::span<const byte> image, hword origin, const CodeMap& map, const LoopBounds& bounds)
+            : image(image), origin(origin), map(map), bounds(bounds)
+        {
+            for (std::size_t b = 0; b < map.blocks.size(); b++)
+            {
+                const BasicBlock& block = map.blocks[b];
+                block_at[block.first] = b;
+                dword cycles = 0;
+                for (std::size_t i = block.begin; i < block.end; i++)
+                {
+                    const Decoded& instruction = map.code[i];
+                    const OpcodeEntry& op = opcode_table[instruction.opcode];
+                    cycles += op.cycles;
+                    bool aligned = (op.mode == AddrMode::AbsoluteX || op.mode == AddrMode::AbsoluteY)
+                        && Byte(instruction.address + 1) == 0;
+                    if (op.mode != AddrMode::Relative && !aligned)
+                    {
+                        cycles += op.page_penalty;
+                    }
+                }
+                base.push_back(cycles);
+            }
+        }
+
+        // Cycles of a block when it is left for a successor
+        dword Leaving(int b, hword successor) const
+        {
+            const BasicBlock& block = map.blocks[b];
+            const Decoded& last = map.code[block.end - 1];
+            const OpcodeEntry& op = opcode_table[last.opcode];
+            hword next = last.address + op.length;
+            // A branch to the next instruction still pays for being taken
+            if (op.mode != AddrMode::Relative || successor != last.target)
+            {
+                return base[b];
+            }
+            return base[b] + op.page_penalty + ((last.target >> 8) != (next >> 8) ? 1 : 0);
+        }
+
+        dword Routine(hword entry);
+    };
+
+    dword Estimator::Routine(hword entry)
+    {
+        if (auto done = routines.find(entry); done != routines.end())
+        {
+            return done->second;
+        }
+        if (std::find(calling.begin(), calling.end(), entry) != calling.end() || block_at[entry] < 0)
+        {
+            return UNBOUNDED;
+        }
+        calling.push_back(entry);
+
+        // The routine's graph: blocks reached from the entry, calls
+        // stepped over. Two extra nodes stand for returning and for
+        // going somewhere unknown
+        std::vector<int> nodes;
+        std::map<int, int> node_of;     // Block -> node
+        std::vector<Edge> edges;
+        std::vector<int> work = { block_at[entry] };
+        node_of[block_at[entry]] = 0;
+        nodes.push_back(block_at[entry]);
+        bool unknown = false;
+        std::vector<std::pair<int, int>> pending;   // Edges to blocks, by block
+        std::vector<dword> pending_cost;
+        while (!work.empty() && !unknown)
+        {
+            int b = work.back();
+            work.pop_back();
+            const BasicBlock& block = map.blocks[b];
+            const Decoded& last = map.code[block.end - 1];
+            Operation operation = opcode_table[last.opcode].operation;
+
+            std::vector<std::pair<hword, dword>> next;  // Successor, cost of getting there
+            if (operation == Operation::RTS || operation == Operation::RTI)
+            {
+                pending.push_back({ b, -1 });
+                pending_cost.push_back(base[b]);
+                continue;
+            }
+            if (operation == Operation::JSR)
+            {
+                dword callee = Routine(last.target);
+                if (callee == UNBOUNDED || block.successors.size() < 2)
+                {
+                    unknown = true;
+                    break;
+                }
+                next.push_back({ block.successors[1], Sum(base[b], callee) });
+            }
+            else if (operation == Operation::JAM)
+            {
+                continue;   // Never goes on
+            }
+            else if (block.successors.empty())
+            {
+                unknown = true;     // Indirect jump or BRK
+                break;
+            }
+            else
+            {
+                for (hword successor: block.successors)
+                {
+                    next.push_back({ successor, Leaving(b, successor) });
+                }
+            }
+            for (auto [successor, cost]: next)
+            {
+                int s = block_at[successor];
+                if (s < 0)
+                {
+                    unknown = true;
+                    break;
+                }
+                if (!node_of.count(s))
+                {
+                    node_of[s] = nodes.size();
+                    nodes.push_back(s);
+                    work.push_back(s);
+                }
+                pending.push_back({ b, s });
+                pending_cost.push_back(cost);
+            }
+        }
+        if (unknown)
+        {
+            calling.pop_back();
+            return routines[entry] = UNBOUNDED;
+        }
+        const int n = nodes.size();
+        const int exit = n;
+        for (std::size_t e = 0; e < pending.size(); e++)
+        {
+            edges.push_back({ node_of[pending[e].first], pending[e].second < 0 ? exit : node_of[pending[e].second], pending_cost[e] });
+        }
+
+        // Loops: the natural loop of each back edge, merged by head
+        std::vector<std::vector<int>> out(n + 1);
+        std::vector<std::vector<int>> in(n + 1);
+        for (std::size_t e = 0; e < edges.size(); e++)
+        {
+            out[edges[e].from].push_back(e);
+            in[edges[e].to].push_back(e);
+        }
+        std::vector<int> state(n + 1, 0);   // 0: not seen, 1: on the path, 2: done
+        std::map<int, std::vector<bool>> loops;     // Head -> body
+        std::vector<std::pair<int, std::size_t>> path = { { 0, 0 } };    // Depth-first path: node, next edge out of it
+        state[0] = 1;
+        while (!path.empty())
+        {
+            int v = path.back().first;
+            if (path.back().second == out[v].size())
+            {
+                state[v] = 2;
+                path.pop_back();
+                continue;
+            }
+            int w = edges[out[v][path.back().second++]].to;
+            if (state[w] == 1)
+            {
+                auto& body = loops.try_emplace(w, std::vector<bool>(n + 1)).first->second;
+                body[w] = true;
+                std::vector<int> back = { v };
+                while (!back.empty())
+                {
+                    int u = back.back();
+                    back.pop_back();
+                    if (body[u])
+                    {
+                        continue;
+                    }
+                    body[u] = true;
+                    for (int f: in[u])
+                    {
+                        back.push_back(edges[f].from);
+                    }
+                }
+            }
+            else if (state[w] == 0)
+            {
+                state[w] = 1;
+                path.push_back({ w, 0 });
+            }
+        }
+
+        // Innermost loops first: each is collapsed into its head, which
+        // then stands for the whole loop
+        std::vector<std::pair<int, int>> order;     // Size, head
+        for (auto& [head, body]: loops)
+        {
+            order.push_back({ (int)std::count(body.begin(), body.end(), true), head });
+        }
+        std::sort(order.begin(), order.end());
+        std::vector<int> rep(n + 1);
+        for (int v = 0; v <= n; v++)
+        {
+            rep[v] = v;
+        }
+        bool bounded = true;
+        for (auto [size, head]: order)
+        {
+            auto found = bounds.find(map.blocks[nodes[head]].first);
+            if (found == bounds.end() || found->second == 0)
+            {
+                bounded = false;
+                break;
+            }
+            std::vector<bool> body(n + 1);
+            for (int v = 0; v < n; v++)
+            {
+                body[rep[v]] = body[rep[v]] || loops[head][v];
+            }
+
+            // Longest paths from the head through the body, back edges left out
+            std::vector<dword> within(n + 1, 0);
+            std::vector<int> indegree(n + 1, 0);
+            for (const Edge& edge: edges)
+            {
+                if (body[edge.from] && body[edge.to] && edge.to != head)
+                {
+                    indegree[edge.to]++;
+                }
+            }
+            std::vector<std::vector<int>> outgoing(n + 1);
+            for (std::size_t e = 0; e < edges.size(); e++)
+            {
+                outgoing[edges[e].from].push_back(e);
+            }
+            std::vector<int> ready = { head };
+            int placed = 0;
+            while (!ready.empty())
+            {
+                int v = ready.back();
+                ready.pop_back();
+                placed++;
+                for (int e: outgoing[v])
+                {
+                    const Edge& edge = edges[e];
+                    if (body[edge.to] && edge.to != head)
+                    {
+                        within[edge.to] = std::max(within[edge.to], Sum(within[v], edge.cost));
+                        if (--indegree[edge.to] == 0)
+                        {
+                            ready.push_back(edge.to);
+                        }
+                    }
+                }
+            }
+            dword iteration = 0;
+            bool entered_elsewhere = false;
+            for (const Edge& edge: edges)
+            {
+                if (body[edge.from] && edge.to == head)
+                {
+                    iteration = std::max(iteration, Sum(within[edge.from], edge.cost));
+                }
+                entered_elsewhere |= !body[edge.from] && body[edge.to] && edge.to != head;
+            }
+            if (entered_elsewhere || placed != std::count(body.begin(), body.end(), true))
+            {
+                bounded = false;    // Not a loop with a single way in
+                break;
+            }
+
+            // All but the last run go around; the last one leaves
+            dword around = Times(found->second - 1, iteration);
+            std::vector<Edge> collapsed;
+            for (const Edge& edge: edges)
+            {
+                if (!body[edge.from])
+                {
+                    collapsed.push_back(edge);
+                }
+                else if (!body[edge.to])
+                {
+                    collapsed.push_back({ head, edge.to, Sum(around, Sum(within[edge.from], edge.cost)) });
+                }
+            }
+            edges = std::move(collapsed);
+            for (int v = 0; v <= n; v++)
+            {
+                if (body[rep[v]])
+                {
+                    rep[v] = head;
+                }
+            }
+        }
+
+        // What is left is acyclic: longest path to the exit
+        dword worst = UNBOUNDED;
+        if (bounded)
+        {
+            std::vector<dword> longest(n + 1, 0);
+            std::vector<bool> reached(n + 1, false);
+            std::vector<int> indegree(n + 1, 0);
+            std::vector<std::vector<int>> outgoing(n + 1);
+            for (std::size_t e = 0; e < edges.size(); e++)
+            {
+                indegree[edges[e].to]++;
+                outgoing[edges[e].from].push_back(e);
+            }
+            std::vector<int> ready = { 0 };
+            reached[0] = true;
+            while (!ready.empty())
+            {
+                int v = ready.back();
+                ready.pop_back();
+                for (int e: outgoing[v])
+                {
+                    const Edge& edge = edges[e];
+                    longest[edge.to] = std::max(longest[edge.to], Sum(longest[v], edge.cost));
+                    reached[edge.to] = true;
+                    if (--indegree[edge.to] == 0)
+                    {
+                        ready.push_back(edge.to);
+                    }
+                }
+            }
+            if (reached[exit])
+            {
+                worst = longest[exit];
+            }
+        }
+        calling.pop_back();
+        return routines[entry] = worst;
+    }
+}
+
+CycleEstimate EstimateCycles(std::span<const byte> image, hword origin, const CodeMap& map,
+    const LoopBounds& bounds, std::span<const hword> entries)
+{
+    Estimator estimator(image, origin, map, bounds);
+    CycleEstimate estimate;
+    for (std::size_t b = 0; b < map.blocks.size(); b++)
+    {
+        dword worst = estimator.base[b];
+        for (hword successor: map.blocks[b].successors)
+        {
+            worst = std::max(worst, estimator.Leaving(b, successor));
+        }
+        estimate.blocks.push_back(worst);
+    }
+
+    std::vector<hword> routines(entries.begin(), entries.end());
+    for (const Decoded& instruction: map.code)
+    {
+        if (opcode_table[instruction.opcode].operation == Operation::JSR)
+        {
+            routines.push_back(instruction.target);
+        }
+    }
+    for (hword entry: routines)
+    {
+        estimate.routines[entry] = estimator.Routine(entry);
+    }
+    return estimate;
+}
+
+void CycleEstimate::Print(std::FILE* out, const CodeMap& map) const
+{
+    for (std::size_t b = 0; b < blocks.size(); b++)
+    {
+        std::fprintf(out, "block $%04X-$%04X %llu\n", map.blocks[b].first, map.blocks[b].last, (unsigned long long)blocks[b]);
+    }
+    for (auto [entry, cycles]: routines)
+    {
+        if (cycles == UNBOUNDED)
+        {
+            std::fprintf(out, "routine $%04X unbounded\n", entry);
+        }
+        else
+        {
+            std::fprintf(out, "routine $%04X %llu\n", entry, (unsigned long long)cycles);
+        }
+    }
+}
+
+bool LoadLoopBounds(const std::filesystem::path& path, LoopBounds& bounds)
+{
+    std::ifstream fin(path);
+    if (fin.fail())
+    {
+        return false;
+    }
+    std::string kind;
+    word head;
+    word runs;
+    while (fin >> kind >> head >> runs)
+    {
+        if (kind != "loop")
+        {
+            return false;
+        }
+        bounds[head & 0xFFFF] = runs;
+    }
+    return fin.eof();
+}
@@ -0,0 +1,48 @@
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <span>
+#include <vector>
+
+#ifndef NUMBERS_h
+    #include "numbers.hpp"
+    #define NUMBERS_h
+#endif
+
+#ifndef ANALYSIS_h
+    #include "analysis.hpp"
+    #define ANALYSIS_h
+#endif
+
+// **** Worst-case cycle estimates ****
+// Cycle bounds computed on the code map of an image, without running it,
+// from the opcode table: the same cycles the interpreter charges. Every
+// instruction costs its base cycles, plus its page-crossing cycle unless it
+// provably stays within the page (absolute indexed with a page-aligned
+// base); branches cost their taken cycles on the taken edge, including a
+// crossing if the destination is on another page. A routine runs from its
+// entry to RTS or RTI, calls cost the callee's worst case, and loops need a
+// bound: the most times their body runs each time the loop is entered,
+// keyed by the loop head's address.
+// Loops without a bound, recursion, control going where the map does not
+// know and routines that never return make a routine unbounded
+
+static constexpr dword UNBOUNDED = ~(dword)0;
+
+using LoopBounds = std::map<hword, word>;   // Loop head -> most runs of the body per entry
+
+struct CycleEstimate
+{
+    std::vector<dword> blocks;  // Worst case of one pass through each block of the map
+    std::map<hword, dword> routines;    // Worst case from each routine entry to its return, or UNBOUNDED
+
+    void Print(std::FILE* out, const CodeMap& map) const;
+};
+
+// Estimate the blocks of the map and the routines entered at the given
+// addresses and by JSR
+CycleEstimate EstimateCycles(std::span<const byte> image, hword origin, const CodeMap& map,
+    const LoopBounds& bounds, std::span<const hword> entries);
+
+// Loop bounds, one per line: loop <head address> <most runs>
+bool LoadLoopBounds(const std::filesystem::path&, LoopBounds&);
@@ -1,3 +1,4 @@
+#include <cctype>
 #include <cstdio>
 #include <filesystem>
 #include <fstream>
@@ -19,11 +20,36 @@
     #define MEMORY_h
 #endif
 
+#ifndef DEVICES_h
+    #include "devices.hpp"
+    #define DEVICES_h
+#endif
+
 #ifndef CPU_h
     #include "CPU.hpp"
     #define CPU_h
 #endif
 
+#ifndef ANALYSIS_h
+    #include "analysis.hpp"
+    #define ANALYSIS_h
+#endif
+
+#ifndef ESTIMATOR_h
+    #include "estimator.hpp"
+    #define ESTIMATOR_h
+#endif
+
+#ifndef RECOMPILER_h
+    #include "recompiler.hpp"
+    #define RECOMPILER_h
+#endif
+
+#ifndef CACHE_h
+    #include "cache.hpp"
+    #define CACHE_h
+#endif
+
 // Load 6502 binary from file
 std::vector<byte> load_program(std::string path)
 {
@@ -39,7 +65,7 @@ std::vector<byte> load_program(std::string path)
 }
 
 // Dump memory to file
-void dump_exec(std::string path, Memory m)
+void dump_exec(const std::string& path, const Memory& m)
 {
     std::ofstream fout;
     fout.open(path, std::ios::binary);
@@ -49,7 +75,7 @@ void dump_exec(std::string path, Memory m)
         exit(1);
     }
 
-    for (int i = 0; i < MEM_SIZE; i++)
+    for (word i = 0; i < MEM_SIZE; i++)
     {
         fout << m[i];
     }
@@ -64,8 +90,74 @@ struct ProgramFlags
     bool dumpStatus = false;
     bool dumpMem = false;
     std::string dumpPath;
+    bool console = false;
+    hword consoleAddress;
+    std::string recompilePath;
+    std::string cachePath;
+    std::string profilePath;
+    std::string codemapPath;
+    std::string wcetPath;
+    std::string loopsPath;
+    bool measure = false;
+    hword measureStart;
+    hword measureStop;
+    dword measureWidth = 1;
+    dword measureLow = 0;
 };
 
+// Run a loaded program with the options given
+template <typename Cpu>
+void run_program(Cpu& cpu, const ProgramFlags& pf, const std::vector<byte>& loaded_program)
+{
+    // Load program
+    cpu.memory.WriteProgram(loaded_program, pf.start_point);
+
+    // Attach the console (if required), reading standard input as the program asks for it
+    std::shared_ptr<Console> console;
+    if (pf.console)
+    {
+        console = std::make_shared<Console>(stdout);
+        console->ReadInput(stdin);
+        cpu.memory.Attach(console, pf.consoleAddress, pf.consoleAddress);
+    }
+
+    // Execute
+    cpu.execute(pf.start_point);
+    if (console)
+    {
+        console->Flush();
+    }
+
+    // Output registers at end of execution (if required)
+    if (pf.dumpStatus)
+    {
+        // Main registers
+        std::printf("%s", "---- Registers: ---- \n");
+        std::printf("Accumulator (A): %d \n", (int)cpu.A);
+        std::printf("Index 1 (X): %d \n", (int)cpu.X);
+        std::printf("Index 2 (Y): %d \n", (int)cpu.Y);
+        std::printf("Program Counter (PC): %d \n", (int)cpu.PC);
+        std::printf("Stack Pointer (SP): %d \n", (int)cpu.SP);
+
+        // Status flags
+        std::printf("\n%s", "---- Flags: ---- \n");
+        std::printf("Negative flag (N): %d \n", (int)cpu.N);
+        std::printf("Zero flag (Z): %d \n", (int)cpu.Z);
+        std::printf("Break flag (B): %d \n", (int)cpu.B);
+        std::printf("Carry flag (C): %d \n", (int)cpu.C);
+        std::printf("Interrupt flag (I): %d \n", (int)cpu.I);
+        std::printf("Decimal flag (D): %d \n", (int)cpu.D);
+        std::printf("Overflow flag (V): %d \n", (int)cpu.V);
+    }
+
+
+    // Write memdump file (if required)
+    if (pf.dumpMem)
+    {
+        dump_exec(pf.dumpPath, cpu.memory);
+    }
+}
+
 int go(int argc, char* argv[])
 {
     std::vector<std::string> args(argv, argv + argc);
@@ -77,6 +169,14 @@ int go(int argc, char* argv[])
     static constexpr auto status_rxp = ctll::fixed_string{ "-showstatus" };
     static constexpr auto dump_rxp = ctll::fixed_string{ "(-dump=)(.*)" };
     static constexpr auto start_rxp = ctll::fixed_string{ "(-start=)(\\d*)" };
+    static constexpr auto console_rxp = ctll::fixed_string{ "(-console=)(\\d*)" };
+    static constexpr auto recompile_rxp = ctll::fixed_string{ "(-recompile=)(.*)" };
+    static constexpr auto cache_rxp = ctll::fixed_string{ "(-cache=)(.*)" };
+    static constexpr auto profile_rxp = ctll::fixed_string{ "(-profile=)(.*)" };
+    static constexpr auto codemap_rxp = ctll::fixed_string{ "(-codemap=)(.*)" };
+    static constexpr auto wcet_rxp = ctll::fixed_string{ "(-wcet=)(.*)" };
+    static constexpr auto loops_rxp = ctll::fixed_string{ "(-loops=)(.*)" };
+    static constexpr auto measure_rxp = ctll::fixed_string{ "(-measure=)(\\d*):(\\d*)(:(\\d*):(\\d*))?" };
 
     // Match CLI arguments
     for (std::string s: args)
@@ -84,7 +184,7 @@ int go(int argc, char* argv[])
         // Number of cycles
         if (auto m = ctre::match<cycles_rxp>(s))
         {
-            pf.cycles = m.get<2>();
+            pf.cycles = m.get<2>().to_number<word>();
         }
         // 6502 binary path
         else if (auto m = ctre::match<path_rxp>(s))
@@ -105,7 +205,56 @@ int go(int argc, char* argv[])
         // PC start point
         else if (auto m = ctre::match<start_rxp>(s))
         {
-            pf.start_point = m.get<2>();
+            pf.start_point = m.get<2>().to_number<hword>();
+        }
+        // Console device address
+        else if (auto m = ctre::match<console_rxp>(s))
+        {
+            pf.console = true;
+            pf.consoleAddress = m.get<2>().to_number<hword>();
+        }
+        // Translate to C++ instead of running
+        else if (auto m = ctre::match<recompile_rxp>(s))
+        {
+            pf.recompilePath = m.get<2>().to_string();
+        }
+        // Decode cache directory
+        else if (auto m = ctre::match<cache_rxp>(s))
+        {
+            pf.cachePath = m.get<2>().to_string();
+        }
+        // Profile to write after running, or to lay out a translation with
+        else if (auto m = ctre::match<profile_rxp>(s))
+        {
+            pf.profilePath = m.get<2>().to_string();
+        }
+        // Code/data map output
+        else if (auto m = ctre::match<codemap_rxp>(s))
+        {
+            pf.codemapPath = m.get<2>().to_string();
+        }
+        // Worst-case cycle estimate output
+        else if (auto m = ctre::match<wcet_rxp>(s))
+        {
+            pf.wcetPath = m.get<2>().to_string();
+        }
+        // Loop bounds for the estimate
+        else if (auto m = ctre::match<loops_rxp>(s))
+        {
+            pf.loopsPath = m.get<2>().to_string();
+        }
+        // Region to time: start and stop addresses, then optionally the
+        // width and low bound of the histogram buckets
+        else if (auto m = ctre::match<measure_rxp>(s))
+        {
+            pf.measure = true;
+            pf.measureStart = m.get<2>().to_number<hword>();
+            pf.measureStop = m.get<3>().to_number<hword>();
+            if (m.get<4>())
+            {
+                pf.measureWidth = m.get<5>().to_number<dword>();
+                pf.measureLow = m.get<6>().to_number<dword>();
+            }
         }
     }
 
@@ -116,41 +265,136 @@ int go(int argc, char* argv[])
         exit(1);
     }
 
-    // Create CPU and load program
-    CPU cpu(pf.cycles);
-    std::vector<byte> loaded_program = load_program(pf.path);
-    cpu.memory.WriteProgram(loaded_program, pf.start_point);
+    // Histogram buckets take at least one cycle each
+    if (pf.measure && pf.measureWidth == 0)
+    {
+        std::printf("-measure= buckets must be at least one cycle wide");
+        exit(1);
+    }
 
-    // Execute
-    cpu.execute(pf.start_point);
+    // A run collects a profile or times a region, not both
+    if (!pf.profilePath.empty() && pf.measure && pf.recompilePath.empty())
+    {
+        std::printf("-profile= and -measure= cannot be used in the same run");
+        exit(1);
+    }
 
-    // Output registers at end of execution (if required)
-    if (pf.dumpStatus)
+    // Map code and data (if required), then stop unless translating too
+    std::vector<byte> loaded_program = load_program(pf.path);
+    if (!pf.codemapPath.empty())
     {
-        // Main registers
-        std::printf("%s", "---- Registers: ---- \n");
-        std::printf("Accumulator (A): %d \n", (int)cpu.A);
-        std::printf("Index 1 (X): %d \n", (int)cpu.X);
-        std::printf("Index 2 (Y): %d \n", (int)cpu.Y);
-        std::printf("Program Counter (PC): %d \n", (int)cpu.PC);
-        std::printf("Stack Pointer (SP): %d \n", (int)cpu.SP);
+        std::FILE* out = std::fopen(pf.codemapPath.c_str(), "w");
+        if (out == nullptr)
+        {
+            std::printf("Error writing code map file");
+            exit(1);
+        }
+        MapCode(loaded_program, pf.start_point, pf.start_point).Print(out, pf.start_point, loaded_program.size());
+        std::fclose(out);
+        if (pf.recompilePath.empty() && pf.wcetPath.empty())
+        {
+            return 0;
+        }
+    }
 
-        // Status flags
-        std::printf("\n%s", "---- Flags: ---- \n");
-        std::printf("Negative flag (N): %d \n", (int)cpu.N);
-        std::printf("Zero flag (Z): %d \n", (int)cpu.Z);
-        std::printf("Break flag (B): %d \n", (int)cpu.B);
-        std::printf("Carry flag (C): %d \n", (int)cpu.C);
-        std::printf("Interrupt flag (I): %d \n", (int)cpu.I);
-        std::printf("Decimal flag (D): %d \n", (int)cpu.D);
-        std::printf("Overflow flag (V): %d \n", (int)cpu.V);
+    // Estimate worst-case cycles (if required) from the start point and the
+    // vectors the binary holds, then stop unless translating too
+    if (!pf.wcetPath.empty())
+    {
+        LoopBounds bounds;
+        if (!pf.loopsPath.empty() && !LoadLoopBounds(pf.loopsPath, bounds))
+        {
+            std::printf("Error reading loop bounds file");
+            exit(1);
+        }
+        CodeMap map = MapCode(loaded_program, pf.start_point, pf.start_point);
+        std::FILE* out = std::fopen(pf.wcetPath.c_str(), "w");
+        if (out == nullptr)
+        {
+            std::printf("Error writing estimate file");
+            exit(1);
+        }
+        EstimateCycles(loaded_program, pf.start_point, map, bounds, map.entries).Print(out, map);
+        std::fclose(out);
+        if (pf.recompilePath.empty())
+        {
+            return 0;
+        }
     }
 
+    // Translate the program (if required): the function is named after the output file
+    if (!pf.recompilePath.empty())
+    {
+        std::string name = std::filesystem::path(pf.recompilePath).stem().string();
+        for (char& c: name)
+        {
+            c = std::isalnum((unsigned char)c) ? c : '_';
+        }
 
-    // Write memdump file (if required)
-    if (pf.dumpMem)
+        // Code entered in a profiled run is translated too, even if the
+        // traversal cannot reach it
+        std::vector<hword> entries = { pf.start_point };
+        Profile profile;
+        bool profiled = !pf.profilePath.empty();
+        if (profiled && !profile.Load(pf.profilePath))
+        {
+            std::printf("Error reading profile file");
+            exit(1);
+        }
+        if (profiled)
+        {
+            for (hword entry: profile.HotEntries())
+            {
+                entries.push_back(entry);
+            }
+        }
+
+        std::vector<Decoded> code;
+        if (!pf.cachePath.empty())
+        {
+            DecodeCache cache(pf.cachePath);
+            code = cache.FindCode(loaded_program, pf.start_point, entries);
+            cache.Report(stdout);
+        }
+        else
+        {
+            code = FindCode(loaded_program, pf.start_point, entries);
+        }
+        std::ofstream fout(pf.recompilePath);
+        fout << Recompile(code, pf.start_point, name, profiled ? &profile : nullptr);
+        if (fout.fail())
+        {
+            std::printf("Error writing translation file");
+            exit(1);
+        }
+        return 0;
+    }
+
+    // Run, collecting a profile or timing a region (if required)
+    if (!pf.profilePath.empty())
     {
-        dump_exec(pf.dumpPath, cpu.memory);
+        ProfileCPU cpu(pf.cycles);
+        run_program(cpu, pf, loaded_program);
+        if (!cpu.trace.profile->Save(pf.profilePath))
+        {
+            std::printf("Error writing profile file");
+            exit(1);
+        }
+    }
+    else if (pf.measure)
+    {
+        MeasureCPU cpu(pf.cycles);
+        cpu.trace.start = pf.measureStart;
+        cpu.trace.stop = pf.measureStop;
+        cpu.trace.histogram = std::make_shared<CycleHistogram>(pf.measureWidth, pf.measureLow);
+        run_program(cpu, pf, loaded_program);
+        std::printf("%s", "---- Cycles: ---- \n");
+        cpu.trace.histogram->Print(stdout);
+    }
+    else
+    {
+        CPU cpu(pf.cycles);
+        run_program(cpu, pf, loaded_program);
     }
 
     return 0;
@@ -0,0 +1,52 @@
+#ifndef MEASURE_h
+    #include "measure.hpp"
+    #define MEASURE_h
+#endif
+
+void CycleHistogram::Add(dword cycles)
+{
+    passes++;
+    total += cycles;
+    shortest = cycles < shortest ? cycles : shortest;
+    longest = cycles > longest ? cycles : longest;
+    if (cycles < low)
+    {
+        below++;
+    }
+    else if ((cycles - low) / width >= BUCKETS)
+    {
+        above++;
+    }
+    else
+    {
+        buckets[(cycles - low) / width]++;
+    }
+}
+
+void CycleHistogram::Print(std::FILE* out) const
+{
+    if (passes == 0)
+    {
+        std::fprintf(out, "passes 0\n");
+        return;
+    }
+    std::fprintf(out, "passes %llu min %llu max %llu mean %.2f\n", (unsigned long long)passes,
+        (unsigned long long)shortest, (unsigned long long)longest, Mean());
+    if (below > 0)
+    {
+        std::fprintf(out, "below %llu %llu\n", (unsigned long long)low, (unsigned long long)below);
+    }
+    for (std::size_t i = 0; i < BUCKETS; i++)
+    {
+        if (buckets[i] > 0)
+        {
+            dword first = low + i * width;
+            std::fprintf(out, "cycles %llu-%llu %llu\n", (unsigned long long)first,
+                (unsigned long long)(first + width - 1), (unsigned long long)buckets[i]);
+        }
+    }
+    if (above > 0)
+    {
+        std::fprintf(out, "above %llu %llu\n", (unsigned long long)(low + BUCKETS * width - 1), (unsigned long long)above);
+    }
+}
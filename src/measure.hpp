@@ -0,0 +1,34 @@
+#include <array>
+#include <cstdio>
+
+#ifndef NUMBERS_h
+    #include "numbers.hpp"
+    #define NUMBERS_h
+#endif
+
+// **** Cycle measurements ****
+// Cycles taken by every pass through a region of guest code, from its
+// start to its stop, over a run of any length. Passes are timed by
+// MeasureTrace between two PCs (see policies.hpp), or by CycleMarker
+// between two stores (see devices.hpp); interrupts taken inside the region
+// count towards the pass. Only the totals and a fixed number of buckets
+// are kept, so memory does not grow with the run
+struct CycleHistogram
+{
+    static constexpr std::size_t BUCKETS = 64;
+
+    dword low = 0;  // Cycles counted by the first bucket
+    dword width = 1;    // Cycles counted by each bucket
+    std::array<dword, BUCKETS> buckets {};  // Passes in low + i*width .. low + (i+1)*width - 1
+    dword below = 0;    // Passes shorter than the first bucket
+    dword above = 0;    // Passes longer than the last bucket
+    dword passes = 0;
+    dword shortest = ~(dword)0;
+    dword longest = 0;
+    dword total = 0;    // Cycles of all the passes
+
+    CycleHistogram(dword width = 1, dword low = 0) : low(low), width(width) {}
+    void Add(dword cycles);     // Count a pass
+    double Mean() const { return passes ? (double)total / passes : 0; }
+    void Print(std::FILE* out) const;   // Totals, then every bucket with passes in it
+};
@@ -1,34 +1,327 @@
+#include <algorithm>
+#include <stdexcept>
+
 #ifndef MEMORY_h
     #include "memory.hpp"
     #define MEMORY_h
 #endif
 
+Memory::Memory()
+{
+    init();
+}
+
+Memory::Memory(std::shared_ptr<const Image> image)
+{
+    init();
+    MapImage(std::move(image));
+}
+
+Memory::Memory(const Memory& other)
+    : read_map(other.read_map), write_map(other.write_map), read_only(other.read_only),
+      images(other.images), baseline(other.baseline), dirty(other.dirty),
+      in_dirty(other.in_dirty), devices(other.devices), device_of(other.device_of)
+{
+    for (word i = 0; i < PAGES; i++)
+    {
+        if (other.pages[i])
+        {
+            pages[i] = std::make_unique<Page>(*other.pages[i]);
+            read_map[i] = write_map[i] = pages[i]->data();
+        }
+    }
+}
+
+Memory& Memory::operator=(const Memory& other)
+{
+    if (this != &other)
+    {
+        *this = Memory(other);
+    }
+    return *this;
+}
+
 void Memory::init()
 {
-    Mem.fill(0);
+    read_map.fill(blank.data());
+    write_map.fill(nullptr);
+    for (auto& page: pages)
+    {
+        page.reset();
+    }
+    read_only.reset();
+    images.clear();
+    baseline.reset();
+    dirty.clear();
+    in_dirty.reset();
+    devices.clear();
+    device_of.fill(0);
+}
+
+byte* Memory::Materialize(byte page)
+{
+    // Start from what the page reads as now
+    if (spare.empty())
+    {
+        pages[page] = std::make_unique<Page>();
+    }
+    else
+    {
+        pages[page] = std::move(spare.back());
+        spare.pop_back();
+    }
+    MarkDirty(page);
+    std::memcpy(pages[page]->data(), read_map[page], PAGE_SIZE);
+    read_map[page] = write_map[page] = pages[page]->data();
+    return write_map[page];
 }
 
-byte Memory::operator[](hword address) const
+void Memory::Release(byte page)
 {
-    return Mem[address];
+    if (pages[page])
+    {
+        spare.push_back(std::move(pages[page]));
+    }
 }
 
-void Memory::WriteByte(hword address, byte data)
+byte Memory::ReadSlow(hword address) const
 {
-    Mem[address] = data;
+    return devices[device_of[address >> 8] - 1]->Read(address);
 }
 
-byte Memory::ReadByte(hword address)
+void Memory::WriteSlow(hword address, byte data)
 {
-    return Mem[address];
+    if (device_of[address >> 8])
+    {
+        devices[device_of[address >> 8] - 1]->Write(*this, address, data);
+    }
+    else if (!read_only[address >> 8])
+    {
+        Materialize(address >> 8)[address & 0xFF] = data;
+    }
 }
 
-void Memory::WriteProgram(std::vector<byte> program, hword index)
+void Memory::WriteProgram(std::span<const byte> program, hword index)
 {
-    int i = index;
+    hword i = index;
     for (byte b: program)
     {
-        Mem[i] = b;
+        WriteByte(i, b);
         i++;
     }
-}
\ No newline at end of file
+}
+
+void Memory::Copy(hword destination, hword source, word length)
+{
+    while (length > 0)
+    {
+        // Stay within one page on both sides, and copy no further ahead
+        // than the gap between overlapping ranges, like a byte loop would
+        word count = std::min({ length, PAGE_SIZE - (source & 0xFF), PAGE_SIZE - (destination & 0xFF) });
+        hword gap = destination - source;
+        if (gap != 0 && gap < count)
+        {
+            count = gap;
+        }
+
+        byte page = destination >> 8;
+        byte* to = write_map[page];
+        if (to == nullptr && !device_of[page] && !read_only[page])
+        {
+            to = Materialize(page);
+        }
+        const byte* from = read_map[source >> 8];
+        if (to != nullptr && from != nullptr)
+        {
+            std::memmove(to + (destination & 0xFF), from + (source & 0xFF), count);
+        }
+        else
+        {
+            for (word i = 0; i < count; i++)
+            {
+                WriteByte(destination + i, (*this)[source + i]);
+            }
+        }
+        destination += count;
+        source += count;
+        length -= count;
+    }
+}
+
+void Memory::Fill(hword destination, byte value, word length)
+{
+    while (length > 0)
+    {
+        word count = std::min(length, PAGE_SIZE - (destination & 0xFF));
+        byte page = destination >> 8;
+        byte* to = write_map[page];
+        if (to == nullptr && !device_of[page] && !read_only[page])
+        {
+            to = Materialize(page);
+        }
+        if (to != nullptr)
+        {
+            std::memset(to + (destination & 0xFF), value, count);
+        }
+        else
+        {
+            for (word i = 0; i < count; i++)
+            {
+                WriteByte(destination + i, value);
+            }
+        }
+        destination += count;
+        length -= count;
+    }
+}
+
+bool Memory::HasDevices(hword first, word length) const
+{
+    if (devices.empty() || length == 0)
+    {
+        return false;
+    }
+    for (word page = first >> 8; page <= (first + length - 1) >> 8; page++)
+    {
+        if (device_of[page & 0xFF])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+word Memory::PrivatePages() const
+{
+    word count = 0;
+    for (const auto& page: pages)
+    {
+        count += page != nullptr;
+    }
+    return count;
+}
+
+void Memory::MapImage(std::shared_ptr<const Image> image)
+{
+    for (word i = 0; i < image->Pages(); i++)
+    {
+        byte page = image->FirstPage() + i;
+        Release(page);
+        read_map[page] = image->PageData(i);
+        write_map[page] = nullptr;
+        read_only[page] = true;
+        MarkDirty(page);
+    }
+    images.push_back(std::move(image));
+}
+
+void Memory::MapPage(byte page, byte* data, bool writable)
+{
+    Release(page);
+    read_map[page] = data;
+    write_map[page] = writable ? data : nullptr;
+    read_only[page] = !writable;
+    device_of[page] = 0;
+    MarkDirty(page);
+}
+
+void Memory::Attach(std::shared_ptr<Device> device, hword first, hword last)
+{
+    if (devices.size() >= MAX_DEVICES)
+    {
+        throw std::length_error("Memory: no room for another device");
+    }
+    devices.push_back(std::move(device));
+    for (word page = first >> 8; page <= (word)(last >> 8); page++)
+    {
+        Release(page);
+        read_map[page] = nullptr;
+        write_map[page] = nullptr;
+        device_of[page] = devices.size();
+    }
+}
+
+void Memory::SetBaseline()
+{
+    // Private pages move to the baseline, and stay mapped for reading
+    auto recorded = std::make_shared<Baseline>();
+    for (word i = 0; i < PAGES; i++)
+    {
+        if (pages[i])
+        {
+            recorded->pages.push_back(std::move(pages[i]));
+            write_map[i] = nullptr;
+        }
+    }
+    recorded->read_map = read_map;
+    recorded->read_only = read_only;
+    baseline = std::move(recorded);
+    dirty.clear();
+    in_dirty.reset();
+    for (const auto& device: devices)
+    {
+        device->SetBaseline();
+    }
+}
+
+void Memory::Restore()
+{
+    // Without a baseline, only RAM goes back: written pages read blank
+    // again, images, mapped pages and devices stay as they are
+    if (!baseline)
+    {
+        for (word i = 0; i < PAGES; i++)
+        {
+            if (pages[i])
+            {
+                Release(i);
+                read_map[i] = blank.data();
+                write_map[i] = nullptr;
+            }
+        }
+        dirty.clear();
+        in_dirty.reset();
+        return;
+    }
+
+    for (byte page: dirty)
+    {
+        if (device_of[page])
+        {
+            continue;
+        }
+        Release(page);
+        read_map[page] = baseline->read_map[page];
+        write_map[page] = nullptr;
+        read_only[page] = baseline->read_only[page];
+    }
+
+    // Devices that map pages map them back as they were, which leaves
+    // nothing to put back
+    for (const auto& device: devices)
+    {
+        device->Restore(*this);
+    }
+    dirty.clear();
+    in_dirty.reset();
+}
+
+void Memory::MarkDirty(byte page)
+{
+    if (!in_dirty[page])
+    {
+        in_dirty[page] = true;
+        dirty.push_back(page);
+    }
+}
+
+Image::Image(std::span<const byte> program, hword index) : first(index >> 8)
+{
+    word last = ((word)index + program.size() + Memory::PAGE_SIZE - 1) / Memory::PAGE_SIZE;
+    pages.resize(std::min<word>(last - first, Memory::PAGES));
+    for (word i = 0; i < program.size(); i++)
+    {
+        word offset = (word)(index & 0xFF) + i;
+        pages[(offset / Memory::PAGE_SIZE) % pages.size()][offset % Memory::PAGE_SIZE] = program[i];
+    }
+}
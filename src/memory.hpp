@@ -1,4 +1,9 @@
 #include <array>
+#include <bit>
+#include <bitset>
+#include <cstring>
+#include <memory>
+#include <span>
 #include <vector>
 
 #ifndef NUMBERS_h
@@ -6,15 +11,198 @@
     #define NUMBERS_h
 #endif
 
+class Image;
+class Memory;
+
+// Hardware mapped into the address space. Every access to the pages a
+// device is attached to goes to the device instead of memory
+class Device
+{
+    public:
+    virtual ~Device() = default;
+    virtual byte Read(hword address) = 0;   // Guest read, may have side effects
+    virtual void Write(Memory& memory, hword address, byte data) = 0;   // Guest write, may remap memory
+    virtual void SetBaseline() {}   // The memory recorded its baseline
+    virtual void Restore(Memory&) {}    // The memory went back to its baseline: go back to the state of then
+};
+
+// 64 KiB address space, split in 256-byte pages. Pages that were never
+// written all map to one shared blank page; a page gets its own storage
+// the first time it is written, so an idle instance costs only its tables.
+// Pages can also map a shared read-only image (ROM): writes to them are
+// ignored. Once a baseline is recorded, its pages are shared copy-on-write
+// and Restore puts back only the pages written since. Pages holding devices
+// have no read or write mapping, so only the slow path checks for them
 class Memory
 {
+    public:
+    static constexpr word PAGE_SIZE = 256;
+    static constexpr word PAGES = MEM_SIZE / PAGE_SIZE;
+    static constexpr hword ADDRESS_MASK = 0xFFFF;   // Address bits decoded; no mirroring
+    static constexpr word MAX_DEVICES = 255;    // Devices one Memory can hold, as device_of counts them
+    using Page = std::array<byte, PAGE_SIZE>;
+
     private:
-    std::array<byte, MEM_SIZE> Mem;
+    // Contents recorded by SetBaseline, shared by the copies of a Memory
+    struct Baseline
+    {
+        std::array<const byte*, PAGES> read_map;    // Where each page was read from
+        std::bitset<PAGES> read_only;   // Pages that were mapped to an image
+        std::vector<std::unique_ptr<Page>> pages;   // Pages that were private
+    };
+
+    static inline const Page blank {};  // Shared by all the pages never written
+    std::array<const byte*, PAGES> read_map;    // Where each page is read from
+    std::array<byte*, PAGES> write_map;     // Where each page is written to, nullptr: not private yet
+    std::array<std::unique_ptr<Page>, PAGES> pages;     // Private pages
+    std::bitset<PAGES> read_only;   // Pages mapped to an image
+    std::vector<std::shared_ptr<const Image>> images;   // Images kept alive by the mapping
+    std::shared_ptr<const Baseline> baseline;   // Contents Restore goes back to
+    std::vector<byte> dirty;    // Pages remapped or written since the baseline
+    std::bitset<PAGES> in_dirty;    // Pages listed in dirty, each listed once
+    std::vector<std::unique_ptr<Page>> spare;   // Storage released by Restore, for reuse
+    std::vector<std::shared_ptr<Device>> devices;   // Attached devices, shared by copies
+    std::array<byte, PAGES> device_of {};   // Device of each page, 1-based (0: none)
+
+    byte* Materialize(byte page);   // Give a page its own storage, before its first write
+    void Release(byte page);    // Drop a page's private storage, keeping it for reuse
+    void MarkDirty(byte page);  // List a page for Restore, unless it already is
+    byte ReadSlow(hword address) const;     // Read from a device page
+    void WriteSlow(hword address, byte data);   // Write to a page that is not private
 
     public:
-    void init();
+    Memory();
+    explicit Memory(std::shared_ptr<const Image> image);    // Memory with an image mapped
+    Memory(const Memory&);  // Copies the private pages only
+    Memory(Memory&&) = default;
+    Memory& operator=(const Memory&);
+    Memory& operator=(Memory&&) = default;
+
+    void init();    // Release every page: the whole space reads as zero
     byte operator[](hword address) const;
     void WriteByte(hword address, byte data);   // Write byte to memory, absolute
-    byte ReadByte(hword address);   // Read byte from memory, absolute
-    void WriteProgram(std::vector<byte> program, hword index);  // Write program to memory
-};
\ No newline at end of file
+    byte ReadByte(hword address) { return (*this)[address]; }   // Read byte from memory, absolute
+    hword ReadWord(hword address) const;    // Read 16-bit little-endian word, wrapping at $FFFF
+    void WriteProgram(std::span<const byte> program, hword index);  // Write program to memory
+    void Copy(hword destination, hword source, word length);    // Bulk copy, same result as a forward byte loop
+    void Fill(hword destination, byte value, word length);  // Bulk fill
+    bool HasDevices(hword first, word length) const;    // Any device page in first..first+length-1
+    void MapImage(std::shared_ptr<const Image> image);  // Map an image's pages, read-only
+    void MapPage(byte page, byte* data, bool writable);     // Map a page to outside storage, without copying
+    void Attach(std::shared_ptr<Device> device, hword first, hword last);   // Hand the pages of first..last to a device, throws past MAX_DEVICES
+    void SetBaseline();     // Record the current contents as the baseline
+    void Restore();     // Go back to the baseline (if none, blank the written RAM only)
+    word DirtyPages() const { return dirty.size(); }    // Pages Restore has to put back
+    bool Written(byte page) const { return in_dirty[page]; }    // Page written or remapped since the baseline
+    word PrivatePages() const;  // Number of pages with their own storage
+};
+
+// Memory contents prepared once and mapped read-only by any number of
+// Memory objects. Bytes of the covered pages outside the program are zero
+class Image
+{
+    private:
+    byte first;     // First page covered
+    std::vector<Memory::Page> pages;    // Contents of the covered pages
+
+    public:
+    Image(std::span<const byte> program, hword index);   // Image of a program loaded at index
+    byte FirstPage() const { return first; }
+    word Pages() const { return pages.size(); }
+    const byte* PageData(word i) const { return pages[i].data(); }  // i-th covered page
+};
+
+inline byte Memory::operator[](hword address) const
+{
+    const byte* page = read_map[address >> 8];
+    if (page != nullptr)
+    {
+        return page[address & 0xFF];
+    }
+    return ReadSlow(address);
+}
+
+inline void Memory::WriteByte(hword address, byte data)
+{
+    byte* page = write_map[address >> 8];
+    if (page != nullptr)
+    {
+        page[address & 0xFF] = data;
+    }
+    else
+    {
+        WriteSlow(address, data);
+    }
+}
+
+inline hword Memory::ReadWord(hword address) const
+{
+    // Across a page boundary the two bytes may live anywhere
+    if ((address & 0xFF) == 0xFF || read_map[address >> 8] == nullptr)
+    {
+        return (hword)((*this)[address] | ((*this)[(hword)(address + 1)] << 8));
+    }
+
+    hword data;
+    std::memcpy(&data, &read_map[address >> 8][address & 0xFF], sizeof(data));
+    if constexpr (std::endian::native == std::endian::big)
+    {
+        data = (hword)((data << 8) | (data >> 8));
+    }
+    return data;
+}
+
+// Flat RAM of Size bytes (a power of two), mirrored across the whole 64 KiB
+// space: address bits above Size are ignored. Small sizes keep an instance
+// in cache; no paging, images or devices
+template <word Size>
+class MirroredRam
+{
+    static_assert(Size >= 256 && Size <= MEM_SIZE && (Size & (Size - 1)) == 0, "RAM size must be a power of two, 256 bytes to 64 KiB");
+
+    private:
+    static constexpr hword MASK = Size - 1;
+    std::array<byte, Size + 1> Mem {};  // Byte 0 repeated at the end, for word reads at the top
+
+    public:
+    static constexpr hword ADDRESS_MASK = MASK;     // Address bits decoded; the rest mirror
+    void init() { Mem.fill(0); }
+    byte operator[](hword address) const { return Mem[address & MASK]; }
+    void WriteByte(hword address, byte data);   // Write byte to memory, absolute
+    byte ReadByte(hword address) { return (*this)[address]; }   // Read byte from memory, absolute
+    hword ReadWord(hword address) const;    // Read 16-bit little-endian word, wrapping at the RAM size
+    void WriteProgram(std::span<const byte> program, hword index);  // Write program to memory
+};
+
+template <word Size>
+inline void MirroredRam<Size>::WriteByte(hword address, byte data)
+{
+    Mem[address & MASK] = data;
+    if ((address & MASK) == 0)
+    {
+        Mem[Size] = data;
+    }
+}
+
+template <word Size>
+inline hword MirroredRam<Size>::ReadWord(hword address) const
+{
+    hword data;
+    std::memcpy(&data, &Mem[address & MASK], sizeof(data));
+    if constexpr (std::endian::native == std::endian::big)
+    {
+        data = (hword)((data << 8) | (data >> 8));
+    }
+    return data;
+}
+
+template <word Size>
+void MirroredRam<Size>::WriteProgram(std::span<const byte> program, hword index)
+{
+    hword i = index;
+    for (byte b: program)
+    {
+        WriteByte(i, b);
+        i++;
+    }
+}
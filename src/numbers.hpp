@@ -3,5 +3,7 @@
 using byte = std::uint8_t;
 using hword = std::uint16_t;
 using word = std::uint32_t;
+using sword = std::int32_t;     // Signed word, for cycle budgets that may overshoot
+using dword = std::uint64_t;
 
-static constexpr hword MEM_SIZE = 1024 * 64 - 1;
\ No newline at end of file
+static constexpr word MEM_SIZE = 1024 * 64;
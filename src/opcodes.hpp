@@ -1,3 +1,5 @@
+#include <array>
+
 #ifndef NUMBERS_h
     #include "numbers.hpp"
     #define NUMBERS_h
@@ -286,4 +288,307 @@ static constexpr byte SRE_IY = 0x53;   // (Indirect), Y
 static constexpr byte TAS = 0x9B;   // Absolute, Y
 // USBC
 static constexpr byte USBC = 0xEB;   // Immediate
-// NOPs: not listed here
\ No newline at end of file
+// NOPs: not listed here
+
+// **** Opcode table ****
+// Everything known about every opcode: mnemonic, operation, addressing mode,
+// length, NMOS timing and flag usage. The core generates one handler per
+// entry at compile time; tools and policies read the rest from here
+
+enum class Operation : byte
+{
+    Undefined, ADC, AND, ASL, BCC, BCS, BEQ, BMI, BNE, BPL, BVC, BVS, BIT,
+    BRK, CLC, CLD, CLI, CLV, CMP, CPX, CPY, DEC, DEX, DEY, EOR, INC, INX,
+    INY, JMP, JSR, LDA, LDX, LDY, LSR, NOP, ORA, PHA, PHP, PLA, PLP, ROL,
+    ROR, RTI, RTS, SBC, SEC, SED, SEI, STA, STX, STY, TAX, TAY, TSX, TXA,
+    TXS, TYA, ALR, ANC, ANE, ARR, DCP, ISC, LAS, LAX, LXA, RLA, RRA, SAX,
+    SBX, SHA, SHX, SHY, SLO, SRE, TAS, USBC, JAM
+};
+
+enum class AddrMode : byte
+{
+    Implied, Accumulator, Immediate, Zeropage, ZeropageX, ZeropageY,
+    Absolute, AbsoluteX, AbsoluteY, Indirect, IndirectX, IndirectY, Relative
+};
+
+// Status flags, in the layout of the status register (NV-BDIZC)
+static constexpr byte FLAG_C = 0x01;    // Carry
+static constexpr byte FLAG_Z = 0x02;    // Zero
+static constexpr byte FLAG_I = 0x04;    // Interrupt disable
+static constexpr byte FLAG_D = 0x08;    // Decimal
+static constexpr byte FLAG_V = 0x40;    // Overflow
+static constexpr byte FLAG_N = 0x80;    // Negative
+static constexpr byte FLAGS_NZ = FLAG_N | FLAG_Z;
+static constexpr byte FLAGS_NZC = FLAG_N | FLAG_Z | FLAG_C;
+static constexpr byte FLAGS_NVZC = FLAG_N | FLAG_V | FLAG_Z | FLAG_C;
+static constexpr byte FLAGS_ALL = FLAG_N | FLAG_V | FLAG_D | FLAG_I | FLAG_Z | FLAG_C;
+
+// What each opcode does and costs. The interpreter charges exactly these
+// cycles for the documented opcodes, so timing tools can work from the
+// table alone
+struct OpcodeEntry
+{
+    const char* mnemonic;       // Assembler mnemonic, nullptr if unassigned
+    Operation operation;        // Operation performed by the handler
+    AddrMode mode;              // Addressing mode of the operand
+    byte length;                // Bytes, opcode included (BRK skips a padding byte)
+    byte cycles;                // Base cycles on an NMOS 6502 (0: never completes)
+    byte page_penalty;          // Extra cycle on a page crossing (branches: on a taken branch, plus one more on a crossing)
+    byte flags_read;            // Flags the result depends on
+    byte flags_written;         // Flags the instruction may change
+    bool documented;            // Part of the documented instruction set
+};
+
+static constexpr std::array<OpcodeEntry, 256> opcode_table = []
+{
+    std::array<OpcodeEntry, 256> table {};
+
+    table[ADC_IM] = { "ADC", Operation::ADC, AddrMode::Immediate, 2, 2, 0, FLAG_C | FLAG_D, FLAGS_NVZC, true };
+    table[ADC_ZP] = { "ADC", Operation::ADC, AddrMode::Zeropage, 2, 3, 0, FLAG_C | FLAG_D, FLAGS_NVZC, true };
+    table[ADC_ZX] = { "ADC", Operation::ADC, AddrMode::ZeropageX, 2, 4, 0, FLAG_C | FLAG_D, FLAGS_NVZC, true };
+    table[ADC_AB] = { "ADC", Operation::ADC, AddrMode::Absolute, 3, 4, 0, FLAG_C | FLAG_D, FLAGS_NVZC, true };
+    table[ADC_AX] = { "ADC", Operation::ADC, AddrMode::AbsoluteX, 3, 4, 1, FLAG_C | FLAG_D, FLAGS_NVZC, true };
+    table[ADC_AY] = { "ADC", Operation::ADC, AddrMode::AbsoluteY, 3, 4, 1, FLAG_C | FLAG_D, FLAGS_NVZC, true };
+    table[ADC_IX] = { "ADC", Operation::ADC, AddrMode::IndirectX, 2, 6, 0, FLAG_C | FLAG_D, FLAGS_NVZC, true };
+    table[ADC_IY] = { "ADC", Operation::ADC, AddrMode::IndirectY, 2, 5, 1, FLAG_C | FLAG_D, FLAGS_NVZC, true };
+    table[AND_IM] = { "AND", Operation::AND, AddrMode::Immediate, 2, 2, 0, 0, FLAGS_NZ, true };
+    table[AND_ZP] = { "AND", Operation::AND, AddrMode::Zeropage, 2, 3, 0, 0, FLAGS_NZ, true };
+    table[AND_ZX] = { "AND", Operation::AND, AddrMode::ZeropageX, 2, 4, 0, 0, FLAGS_NZ, true };
+    table[AND_AB] = { "AND", Operation::AND, AddrMode::Absolute, 3, 4, 0, 0, FLAGS_NZ, true };
+    table[AND_AX] = { "AND", Operation::AND, AddrMode::AbsoluteX, 3, 4, 1, 0, FLAGS_NZ, true };
+    table[AND_AY] = { "AND", Operation::AND, AddrMode::AbsoluteY, 3, 4, 1, 0, FLAGS_NZ, true };
+    table[AND_IX] = { "AND", Operation::AND, AddrMode::IndirectX, 2, 6, 0, 0, FLAGS_NZ, true };
+    table[AND_IY] = { "AND", Operation::AND, AddrMode::IndirectY, 2, 5, 1, 0, FLAGS_NZ, true };
+    table[ASL_AC] = { "ASL", Operation::ASL, AddrMode::Accumulator, 1, 2, 0, 0, FLAGS_NZC, true };
+    table[ASL_ZP] = { "ASL", Operation::ASL, AddrMode::Zeropage, 2, 5, 0, 0, FLAGS_NZC, true };
+    table[ASL_ZX] = { "ASL", Operation::ASL, AddrMode::ZeropageX, 2, 6, 0, 0, FLAGS_NZC, true };
+    table[ASL_AB] = { "ASL", Operation::ASL, AddrMode::Absolute, 3, 6, 0, 0, FLAGS_NZC, true };
+    table[ASL_AX] = { "ASL", Operation::ASL, AddrMode::AbsoluteX, 3, 7, 0, 0, FLAGS_NZC, true };
+    table[BCC]    = { "BCC", Operation::BCC, AddrMode::Relative, 2, 2, 1, FLAG_C, 0, true };
+    table[BCS]    = { "BCS", Operation::BCS, AddrMode::Relative, 2, 2, 1, FLAG_C, 0, true };
+    table[BEQ]    = { "BEQ", Operation::BEQ, AddrMode::Relative, 2, 2, 1, FLAG_Z, 0, true };
+    table[BMI]    = { "BMI", Operation::BMI, AddrMode::Relative, 2, 2, 1, FLAG_N, 0, true };
+    table[BNE]    = { "BNE", Operation::BNE, AddrMode::Relative, 2, 2, 1, FLAG_Z, 0, true };
+    table[BPL]    = { "BPL", Operation::BPL, AddrMode::Relative, 2, 2, 1, FLAG_N, 0, true };
+    table[BVC]    = { "BVC", Operation::BVC, AddrMode::Relative, 2, 2, 1, FLAG_V, 0, true };
+    table[BVS]    = { "BVS", Operation::BVS, AddrMode::Relative, 2, 2, 1, FLAG_V, 0, true };
+    table[BIT_ZP] = { "BIT", Operation::BIT, AddrMode::Zeropage, 2, 3, 0, 0, FLAG_N | FLAG_V | FLAG_Z, true };
+    table[BIT_AB] = { "BIT", Operation::BIT, AddrMode::Absolute, 3, 4, 0, 0, FLAG_N | FLAG_V | FLAG_Z, true };
+    table[BRK]    = { "BRK", Operation::BRK, AddrMode::Implied, 2, 7, 0, FLAGS_ALL, FLAG_I, true };
+    table[CLC]    = { "CLC", Operation::CLC, AddrMode::Implied, 1, 2, 0, 0, FLAG_C, true };
+    table[CLD]    = { "CLD", Operation::CLD, AddrMode::Implied, 1, 2, 0, 0, FLAG_D, true };
+    table[CLI]    = { "CLI", Operation::CLI, AddrMode::Implied, 1, 2, 0, 0, FLAG_I, true };
+    table[CLV]    = { "CLV", Operation::CLV, AddrMode::Implied, 1, 2, 0, 0, FLAG_V, true };
+    table[CMP_IM] = { "CMP", Operation::CMP, AddrMode::Immediate, 2, 2, 0, 0, FLAGS_NZC, true };
+    table[CMP_ZP] = { "CMP", Operation::CMP, AddrMode::Zeropage, 2, 3, 0, 0, FLAGS_NZC, true };
+    table[CMP_ZX] = { "CMP", Operation::CMP, AddrMode::ZeropageX, 2, 4, 0, 0, FLAGS_NZC, true };
+    table[CMP_AB] = { "CMP", Operation::CMP, AddrMode::Absolute, 3, 4, 0, 0, FLAGS_NZC, true };
+    table[CMP_AX] = { "CMP", Operation::CMP, AddrMode::AbsoluteX, 3, 4, 1, 0, FLAGS_NZC, true };
+    table[CMP_AY] = { "CMP", Operation::CMP, AddrMode::AbsoluteY, 3, 4, 1, 0, FLAGS_NZC, true };
+    table[CMP_IX] = { "CMP", Operation::CMP, AddrMode::IndirectX, 2, 6, 0, 0, FLAGS_NZC, true };
+    table[CMP_IY] = { "CMP", Operation::CMP, AddrMode::IndirectY, 2, 5, 1, 0, FLAGS_NZC, true };
+    table[CPX_IM] = { "CPX", Operation::CPX, AddrMode::Immediate, 2, 2, 0, 0, FLAGS_NZC, true };
+    table[CPX_ZP] = { "CPX", Operation::CPX, AddrMode::Zeropage, 2, 3, 0, 0, FLAGS_NZC, true };
+    table[CPX_AB] = { "CPX", Operation::CPX, AddrMode::Absolute, 3, 4, 0, 0, FLAGS_NZC, true };
+    table[CPY_IM] = { "CPY", Operation::CPY, AddrMode::Immediate, 2, 2, 0, 0, FLAGS_NZC, true };
+    table[CPY_ZP] = { "CPY", Operation::CPY, AddrMode::Zeropage, 2, 3, 0, 0, FLAGS_NZC, true };
+    table[CPY_AB] = { "CPY", Operation::CPY, AddrMode::Absolute, 3, 4, 0, 0, FLAGS_NZC, true };
+    table[DEC_ZP] = { "DEC", Operation::DEC, AddrMode::Zeropage, 2, 5, 0, 0, FLAGS_NZ, true };
+    table[DEC_ZX] = { "DEC", Operation::DEC, AddrMode::ZeropageX, 2, 6, 0, 0, FLAGS_NZ, true };
+    table[DEC_AB] = { "DEC", Operation::DEC, AddrMode::Absolute, 3, 6, 0, 0, FLAGS_NZ, true };
+    table[DEC_AX] = { "DEC", Operation::DEC, AddrMode::AbsoluteX, 3, 7, 0, 0, FLAGS_NZ, true };
+    table[DEX]    = { "DEX", Operation::DEX, AddrMode::Implied, 1, 2, 0, 0, FLAGS_NZ, true };
+    table[DEY]    = { "DEY", Operation::DEY, AddrMode::Implied, 1, 2, 0, 0, FLAGS_NZ, true };
+    table[EOR_IM] = { "EOR", Operation::EOR, AddrMode::Immediate, 2, 2, 0, 0, FLAGS_NZ, true };
+    table[EOR_ZP] = { "EOR", Operation::EOR, AddrMode::Zeropage, 2, 3, 0, 0, FLAGS_NZ, true };
+    table[EOR_ZX] = { "EOR", Operation::EOR, AddrMode::ZeropageX, 2, 4, 0, 0, FLAGS_NZ, true };
+    table[EOR_AB] = { "EOR", Operation::EOR, AddrMode::Absolute, 3, 4, 0, 0, FLAGS_NZ, true };
+    table[EOR_AX] = { "EOR", Operation::EOR, AddrMode::AbsoluteX, 3, 4, 1, 0, FLAGS_NZ, true };
+    table[EOR_AY] = { "EOR", Operation::EOR, AddrMode::AbsoluteY, 3, 4, 1, 0, FLAGS_NZ, true };
+    table[EOR_IX] = { "EOR", Operation::EOR, AddrMode::IndirectX, 2, 6, 0, 0, FLAGS_NZ, true };
+    table[EOR_IY] = { "EOR", Operation::EOR, AddrMode::IndirectY, 2, 5, 1, 0, FLAGS_NZ, true };
+    table[INC_ZP] = { "INC", Operation::INC, AddrMode::Zeropage, 2, 5, 0, 0, FLAGS_NZ, true };
+    table[INC_ZX] = { "INC", Operation::INC, AddrMode::ZeropageX, 2, 6, 0, 0, FLAGS_NZ, true };
+    table[INC_AB] = { "INC", Operation::INC, AddrMode::Absolute, 3, 6, 0, 0, FLAGS_NZ, true };
+    table[INC_AX] = { "INC", Operation::INC, AddrMode::AbsoluteX, 3, 7, 0, 0, FLAGS_NZ, true };
+    table[INX]    = { "INX", Operation::INX, AddrMode::Implied, 1, 2, 0, 0, FLAGS_NZ, true };
+    table[INY]    = { "INY", Operation::INY, AddrMode::Implied, 1, 2, 0, 0, FLAGS_NZ, true };
+    table[JMP_AB] = { "JMP", Operation::JMP, AddrMode::Absolute, 3, 3, 0, 0, 0, true };
+    table[JMP_IN] = { "JMP", Operation::JMP, AddrMode::Indirect, 3, 5, 0, 0, 0, true };
+    table[JSR]    = { "JSR", Operation::JSR, AddrMode::Absolute, 3, 6, 0, 0, 0, true };
+    table[LDA_IM] = { "LDA", Operation::LDA, AddrMode::Immediate, 2, 2, 0, 0, FLAGS_NZ, true };
+    table[LDA_ZP] = { "LDA", Operation::LDA, AddrMode::Zeropage, 2, 3, 0, 0, FLAGS_NZ, true };
+    table[LDA_ZX] = { "LDA", Operation::LDA, AddrMode::ZeropageX, 2, 4, 0, 0, FLAGS_NZ, true };
+    table[LDA_AB] = { "LDA", Operation::LDA, AddrMode::Absolute, 3, 4, 0, 0, FLAGS_NZ, true };
+    table[LDA_AX] = { "LDA", Operation::LDA, AddrMode::AbsoluteX, 3, 4, 1, 0, FLAGS_NZ, true };
+    table[LDA_AY] = { "LDA", Operation::LDA, AddrMode::AbsoluteY, 3, 4, 1, 0, FLAGS_NZ, true };
+    table[LDA_IX] = { "LDA", Operation::LDA, AddrMode::IndirectX, 2, 6, 0, 0, FLAGS_NZ, true };
+    table[LDA_IY] = { "LDA", Operation::LDA, AddrMode::IndirectY, 2, 5, 1, 0, FLAGS_NZ, true };
+    table[LDX_IM] = { "LDX", Operation::LDX, AddrMode::Immediate, 2, 2, 0, 0, FLAGS_NZ, true };
+    table[LDX_ZP] = { "LDX", Operation::LDX, AddrMode::Zeropage, 2, 3, 0, 0, FLAGS_NZ, true };
+    table[LDX_ZY] = { "LDX", Operation::LDX, AddrMode::ZeropageY, 2, 4, 0, 0, FLAGS_NZ, true };
+    table[LDX_AB] = { "LDX", Operation::LDX, AddrMode::Absolute, 3, 4, 0, 0, FLAGS_NZ, true };
+    table[LDX_AY] = { "LDX", Operation::LDX, AddrMode::AbsoluteY, 3, 4, 1, 0, FLAGS_NZ, true };
+    table[LDY_IM] = { "LDY", Operation::LDY, AddrMode::Immediate, 2, 2, 0, 0, FLAGS_NZ, true };
+    table[LDY_ZP] = { "LDY", Operation::LDY, AddrMode::Zeropage, 2, 3, 0, 0, FLAGS_NZ, true };
+    table[LDY_ZX] = { "LDY", Operation::LDY, AddrMode::ZeropageX, 2, 4, 0, 0, FLAGS_NZ, true };
+    table[LDY_AB] = { "LDY", Operation::LDY, AddrMode::Absolute, 3, 4, 0, 0, FLAGS_NZ, true };
+    table[LDY_AX] = { "LDY", Operation::LDY, AddrMode::AbsoluteX, 3, 4, 1, 0, FLAGS_NZ, true };
+    table[LSR_AC] = { "LSR", Operation::LSR, AddrMode::Accumulator, 1, 2, 0, 0, FLAGS_NZC, true };
+    table[LSR_ZP] = { "LSR", Operation::LSR, AddrMode::Zeropage, 2, 5, 0, 0, FLAGS_NZC, true };
+    table[LSR_ZX] = { "LSR", Operation::LSR, AddrMode::ZeropageX, 2, 6, 0, 0, FLAGS_NZC, true };
+    table[LSR_AB] = { "LSR", Operation::LSR, AddrMode::Absolute, 3, 6, 0, 0, FLAGS_NZC, true };
+    table[LSR_AX] = { "LSR", Operation::LSR, AddrMode::AbsoluteX, 3, 7, 0, 0, FLAGS_NZC, true };
+    table[NOP]    = { "NOP", Operation::NOP, AddrMode::Implied, 1, 2, 0, 0, 0, true };
+    table[ORA_IM] = { "ORA", Operation::ORA, AddrMode::Immediate, 2, 2, 0, 0, FLAGS_NZ, true };
+    table[ORA_ZP] = { "ORA", Operation::ORA, AddrMode::Zeropage, 2, 3, 0, 0, FLAGS_NZ, true };
+    table[ORA_ZX] = { "ORA", Operation::ORA, AddrMode::ZeropageX, 2, 4, 0, 0, FLAGS_NZ, true };
+    table[ORA_AB] = { "ORA", Operation::ORA, AddrMode::Absolute, 3, 4, 0, 0, FLAGS_NZ, true };
+    table[ORA_AX] = { "ORA", Operation::ORA, AddrMode::AbsoluteX, 3, 4, 1, 0, FLAGS_NZ, true };
+    table[ORA_AY] = { "ORA", Operation::ORA, AddrMode::AbsoluteY, 3, 4, 1, 0, FLAGS_NZ, true };
+    table[ORA_IX] = { "ORA", Operation::ORA, AddrMode::IndirectX, 2, 6, 0, 0, FLAGS_NZ, true };
+    table[ORA_IY] = { "ORA", Operation::ORA, AddrMode::IndirectY, 2, 5, 1, 0, FLAGS_NZ, true };
+    table[PHA]    = { "PHA", Operation::PHA, AddrMode::Implied, 1, 3, 0, 0, 0, true };
+    table[PHP]    = { "PHP", Operation::PHP, AddrMode::Implied, 1, 3, 0, FLAGS_ALL, 0, true };
+    table[PLA]    = { "PLA", Operation::PLA, AddrMode::Implied, 1, 4, 0, 0, FLAGS_NZ, true };
+    table[PLP]    = { "PLP", Operation::PLP, AddrMode::Implied, 1, 4, 0, 0, FLAGS_ALL, true };
+    table[ROL_AC] = { "ROL", Operation::ROL, AddrMode::Accumulator, 1, 2, 0, FLAG_C, FLAGS_NZC, true };
+    table[ROL_ZP] = { "ROL", Operation::ROL, AddrMode::Zeropage, 2, 5, 0, FLAG_C, FLAGS_NZC, true };
+    table[ROL_ZX] = { "ROL", Operation::ROL, AddrMode::ZeropageX, 2, 6, 0, FLAG_C, FLAGS_NZC, true };
+    table[ROL_AB] = { "ROL", Operation::ROL, AddrMode::Absolute, 3, 6, 0, FLAG_C, FLAGS_NZC, true };
+    table[ROL_AX] = { "ROL", Operation::ROL, AddrMode::AbsoluteX, 3, 7, 0, FLAG_C, FLAGS_NZC, true };
+    table[ROR_AC] = { "ROR", Operation::ROR, AddrMode::Accumulator, 1, 2, 0, FLAG_C, FLAGS_NZC, true };
+    table[ROR_ZP] = { "ROR", Operation::ROR, AddrMode::Zeropage, 2, 5, 0, FLAG_C, FLAGS_NZC, true };
+    table[ROR_ZX] = { "ROR", Operation::ROR, AddrMode::ZeropageX, 2, 6, 0, FLAG_C, FLAGS_NZC, true };
+    table[ROR_AB] = { "ROR", Operation::ROR, AddrMode::Absolute, 3, 6, 0, FLAG_C, FLAGS_NZC, true };
+    table[ROR_AX] = { "ROR", Operation::ROR, AddrMode::AbsoluteX, 3, 7, 0, FLAG_C, FLAGS_NZC, true };
+    table[RTI]    = { "RTI", Operation::RTI, AddrMode::Implied, 1, 6, 0, 0, FLAGS_ALL, true };
+    table[RTS]    = { "RTS", Operation::RTS, AddrMode::Implied, 1, 6, 0, 0, 0, true };
+    table[SBC_IM] = { "SBC", Operation::SBC, AddrMode::Immediate, 2, 2, 0, FLAG_C | FLAG_D, FLAGS_NVZC, true };
+    table[SBC_ZP] = { "SBC", Operation::SBC, AddrMode::Zeropage, 2, 3, 0, FLAG_C | FLAG_D, FLAGS_NVZC, true };
+    table[SBC_ZX] = { "SBC", Operation::SBC, AddrMode::ZeropageX, 2, 4, 0, FLAG_C | FLAG_D, FLAGS_NVZC, true };
+    table[SBC_AB] = { "SBC", Operation::SBC, AddrMode::Absolute, 3, 4, 0, FLAG_C | FLAG_D, FLAGS_NVZC, true };
+    table[SBC_AX] = { "SBC", Operation::SBC, AddrMode::AbsoluteX, 3, 4, 1, FLAG_C | FLAG_D, FLAGS_NVZC, true };
+    table[SBC_AY] = { "SBC", Operation::SBC, AddrMode::AbsoluteY, 3, 4, 1, FLAG_C | FLAG_D, FLAGS_NVZC, true };
+    table[SBC_IX] = { "SBC", Operation::SBC, AddrMode::IndirectX, 2, 6, 0, FLAG_C | FLAG_D, FLAGS_NVZC, true };
+    table[SBC_IY] = { "SBC", Operation::SBC, AddrMode::IndirectY, 2, 5, 1, FLAG_C | FLAG_D, FLAGS_NVZC, true };
+    table[SEC]    = { "SEC", Operation::SEC, AddrMode::Implied, 1, 2, 0, 0, FLAG_C, true };
+    table[SED]    = { "SED", Operation::SED, AddrMode::Implied, 1, 2, 0, 0, FLAG_D, true };
+    table[SEI]    = { "SEI", Operation::SEI, AddrMode::Implied, 1, 2, 0, 0, FLAG_I, true };
+    table[STA_ZP] = { "STA", Operation::STA, AddrMode::Zeropage, 2, 3, 0, 0, 0, true };
+    table[STA_ZX] = { "STA", Operation::STA, AddrMode::ZeropageX, 2, 4, 0, 0, 0, true };
+    table[STA_AB] = { "STA", Operation::STA, AddrMode::Absolute, 3, 4, 0, 0, 0, true };
+    table[STA_AX] = { "STA", Operation::STA, AddrMode::AbsoluteX, 3, 5, 0, 0, 0, true };
+    table[STA_AY] = { "STA", Operation::STA, AddrMode::AbsoluteY, 3, 5, 0, 0, 0, true };
+    table[STA_IX] = { "STA", Operation::STA, AddrMode::IndirectX, 2, 6, 0, 0, 0, true };
+    table[STA_IY] = { "STA", Operation::STA, AddrMode::IndirectY, 2, 6, 0, 0, 0, true };
+    table[STX_ZP] = { "STX", Operation::STX, AddrMode::Zeropage, 2, 3, 0, 0, 0, true };
+    table[STX_ZY] = { "STX", Operation::STX, AddrMode::ZeropageY, 2, 4, 0, 0, 0, true };
+    table[STX_AB] = { "STX", Operation::STX, AddrMode::Absolute, 3, 4, 0, 0, 0, true };
+    table[STY_ZP] = { "STY", Operation::STY, AddrMode::Zeropage, 2, 3, 0, 0, 0, true };
+    table[STY_ZX] = { "STY", Operation::STY, AddrMode::ZeropageX, 2, 4, 0, 0, 0, true };
+    table[STY_AB] = { "STY", Operation::STY, AddrMode::Absolute, 3, 4, 0, 0, 0, true };
+    table[TAX]    = { "TAX", Operation::TAX, AddrMode::Implied, 1, 2, 0, 0, FLAGS_NZ, true };
+    table[TAY]    = { "TAY", Operation::TAY, AddrMode::Implied, 1, 2, 0, 0, FLAGS_NZ, true };
+    table[TSX]    = { "TSX", Operation::TSX, AddrMode::Implied, 1, 2, 0, 0, FLAGS_NZ, true };
+    table[TXA]    = { "TXA", Operation::TXA, AddrMode::Implied, 1, 2, 0, 0, FLAGS_NZ, true };
+    table[TXS]    = { "TXS", Operation::TXS, AddrMode::Implied, 1, 2, 0, 0, 0, true };
+    table[TYA]    = { "TYA", Operation::TYA, AddrMode::Implied, 1, 2, 0, 0, FLAGS_NZ, true };
+    table[ALR]    = { "ALR", Operation::ALR, AddrMode::Immediate, 2, 2, 0, 0, FLAGS_NZC, false };
+    table[ANC]    = { "ANC", Operation::ANC, AddrMode::Immediate, 2, 2, 0, 0, FLAGS_NZC, false };
+    table[ANC2]   = { "ANC", Operation::ANC, AddrMode::Immediate, 2, 2, 0, 0, FLAGS_NZC, false };
+    table[ANE]    = { "ANE", Operation::ANE, AddrMode::Immediate, 2, 2, 0, 0, FLAGS_NZ, false };
+    table[ARR]    = { "ARR", Operation::ARR, AddrMode::Immediate, 2, 2, 0, FLAG_C, FLAGS_NVZC, false };
+    table[DCP_ZP] = { "DCP", Operation::DCP, AddrMode::Zeropage, 2, 5, 0, 0, FLAGS_NZC, false };
+    table[DCP_ZX] = { "DCP", Operation::DCP, AddrMode::ZeropageX, 2, 6, 0, 0, FLAGS_NZC, false };
+    table[DCP_AB] = { "DCP", Operation::DCP, AddrMode::Absolute, 3, 6, 0, 0, FLAGS_NZC, false };
+    table[DCP_AX] = { "DCP", Operation::DCP, AddrMode::AbsoluteX, 3, 7, 0, 0, FLAGS_NZC, false };
+    table[DCP_AY] = { "DCP", Operation::DCP, AddrMode::AbsoluteY, 3, 7, 0, 0, FLAGS_NZC, false };
+    table[DCP_IX] = { "DCP", Operation::DCP, AddrMode::IndirectX, 2, 8, 0, 0, FLAGS_NZC, false };
+    table[DCP_IY] = { "DCP", Operation::DCP, AddrMode::IndirectY, 2, 8, 0, 0, FLAGS_NZC, false };
+    table[ISC_ZP] = { "ISC", Operation::ISC, AddrMode::Zeropage, 2, 5, 0, FLAG_C | FLAG_D, FLAGS_NVZC, false };
+    table[ISC_ZX] = { "ISC", Operation::ISC, AddrMode::ZeropageX, 2, 6, 0, FLAG_C | FLAG_D, FLAGS_NVZC, false };
+    table[ISC_AB] = { "ISC", Operation::ISC, AddrMode::Absolute, 3, 6, 0, FLAG_C | FLAG_D, FLAGS_NVZC, false };
+    table[ISC_AX] = { "ISC", Operation::ISC, AddrMode::AbsoluteX, 3, 7, 0, FLAG_C | FLAG_D, FLAGS_NVZC, false };
+    table[ISC_AY] = { "ISC", Operation::ISC, AddrMode::AbsoluteY, 3, 7, 0, FLAG_C | FLAG_D, FLAGS_NVZC, false };
+    table[ISC_IX] = { "ISC", Operation::ISC, AddrMode::IndirectX, 2, 8, 0, FLAG_C | FLAG_D, FLAGS_NVZC, false };
+    table[ISC_IY] = { "ISC", Operation::ISC, AddrMode::IndirectY, 2, 8, 0, FLAG_C | FLAG_D, FLAGS_NVZC, false };
+    table[LAS]    = { "LAS", Operation::LAS, AddrMode::AbsoluteY, 3, 4, 1, 0, FLAGS_NZ, false };
+    table[LAX_ZP] = { "LAX", Operation::LAX, AddrMode::Zeropage, 2, 3, 0, 0, FLAGS_NZ, false };
+    table[LAX_ZY] = { "LAX", Operation::LAX, AddrMode::ZeropageY, 2, 4, 0, 0, FLAGS_NZ, false };
+    table[LAX_AB] = { "LAX", Operation::LAX, AddrMode::Absolute, 3, 4, 0, 0, FLAGS_NZ, false };
+    table[LAX_AY] = { "LAX", Operation::LAX, AddrMode::AbsoluteY, 3, 4, 1, 0, FLAGS_NZ, false };
+    table[LAX_IX] = { "LAX", Operation::LAX, AddrMode::IndirectX, 2, 6, 0, 0, FLAGS_NZ, false };
+    table[LAX_IY] = { "LAX", Operation::LAX, AddrMode::IndirectY, 2, 5, 1, 0, FLAGS_NZ, false };
+    table[LXA]    = { "LXA", Operation::LXA, AddrMode::Immediate, 2, 2, 0, 0, FLAGS_NZ, false };
+    table[RLA_ZP] = { "RLA", Operation::RLA, AddrMode::Zeropage, 2, 5, 0, FLAG_C, FLAGS_NZC, false };
+    table[RLA_ZX] = { "RLA", Operation::RLA, AddrMode::ZeropageX, 2, 6, 0, FLAG_C, FLAGS_NZC, false };
+    table[RLA_AB] = { "RLA", Operation::RLA, AddrMode::Absolute, 3, 6, 0, FLAG_C, FLAGS_NZC, false };
+    table[RLA_AX] = { "RLA", Operation::RLA, AddrMode::AbsoluteX, 3, 7, 0, FLAG_C, FLAGS_NZC, false };
+    table[RLA_AY] = { "RLA", Operation::RLA, AddrMode::AbsoluteY, 3, 7, 0, FLAG_C, FLAGS_NZC, false };
+    table[RLA_IX] = { "RLA", Operation::RLA, AddrMode::IndirectX, 2, 8, 0, FLAG_C, FLAGS_NZC, false };
+    table[RLA_IY] = { "RLA", Operation::RLA, AddrMode::IndirectY, 2, 8, 0, FLAG_C, FLAGS_NZC, false };
+    table[RRA_ZP] = { "RRA", Operation::RRA, AddrMode::Zeropage, 2, 5, 0, FLAG_C | FLAG_D, FLAGS_NVZC, false };
+    table[RRA_ZX] = { "RRA", Operation::RRA, AddrMode::ZeropageX, 2, 6, 0, FLAG_C | FLAG_D, FLAGS_NVZC, false };
+    table[RRA_AB] = { "RRA", Operation::RRA, AddrMode::Absolute, 3, 6, 0, FLAG_C | FLAG_D, FLAGS_NVZC, false };
+    table[RRA_AX] = { "RRA", Operation::RRA, AddrMode::AbsoluteX, 3, 7, 0, FLAG_C | FLAG_D, FLAGS_NVZC, false };
+    table[RRA_AY] = { "RRA", Operation::RRA, AddrMode::AbsoluteY, 3, 7, 0, FLAG_C | FLAG_D, FLAGS_NVZC, false };
+    table[RRA_IX] = { "RRA", Operation::RRA, AddrMode::IndirectX, 2, 8, 0, FLAG_C | FLAG_D, FLAGS_NVZC, false };
+    table[RRA_IY] = { "RRA", Operation::RRA, AddrMode::IndirectY, 2, 8, 0, FLAG_C | FLAG_D, FLAGS_NVZC, false };
+    table[SAX_ZP] = { "SAX", Operation::SAX, AddrMode::Zeropage, 2, 3, 0, 0, 0, false };
+    table[SAX_ZY] = { "SAX", Operation::SAX, AddrMode::ZeropageY, 2, 4, 0, 0, 0, false };
+    table[SAX_AB] = { "SAX", Operation::SAX, AddrMode::Absolute, 3, 4, 0, 0, 0, false };
+    table[SAX_IX] = { "SAX", Operation::SAX, AddrMode::IndirectX, 2, 6, 0, 0, 0, false };
+    table[SBX]    = { "SBX", Operation::SBX, AddrMode::Immediate, 2, 2, 0, 0, FLAGS_NZC, false };
+    table[SHA_AY] = { "SHA", Operation::SHA, AddrMode::AbsoluteY, 3, 5, 0, 0, 0, false };
+    table[SHA_IY] = { "SHA", Operation::SHA, AddrMode::IndirectY, 2, 6, 0, 0, 0, false };
+    table[SHX]    = { "SHX", Operation::SHX, AddrMode::AbsoluteY, 3, 5, 0, 0, 0, false };
+    table[SHY]    = { "SHY", Operation::SHY, AddrMode::AbsoluteX, 3, 5, 0, 0, 0, false };
+    table[SLO_ZP] = { "SLO", Operation::SLO, AddrMode::Zeropage, 2, 5, 0, 0, FLAGS_NZC, false };
+    table[SLO_ZX] = { "SLO", Operation::SLO, AddrMode::ZeropageX, 2, 6, 0, 0, FLAGS_NZC, false };
+    table[SLO_AB] = { "SLO", Operation::SLO, AddrMode::Absolute, 3, 6, 0, 0, FLAGS_NZC, false };
+    table[SLO_AX] = { "SLO", Operation::SLO, AddrMode::AbsoluteX, 3, 7, 0, 0, FLAGS_NZC, false };
+    table[SLO_AY] = { "SLO", Operation::SLO, AddrMode::AbsoluteY, 3, 7, 0, 0, FLAGS_NZC, false };
+    table[SLO_IX] = { "SLO", Operation::SLO, AddrMode::IndirectX, 2, 8, 0, 0, FLAGS_NZC, false };
+    table[SLO_IY] = { "SLO", Operation::SLO, AddrMode::IndirectY, 2, 8, 0, 0, FLAGS_NZC, false };
+    table[SRE_ZP] = { "SRE", Operation::SRE, AddrMode::Zeropage, 2, 5, 0, 0, FLAGS_NZC, false };
+    table[SRE_ZX] = { "SRE", Operation::SRE, AddrMode::ZeropageX, 2, 6, 0, 0, FLAGS_NZC, false };
+    table[SRE_AB] = { "SRE", Operation::SRE, AddrMode::Absolute, 3, 6, 0, 0, FLAGS_NZC, false };
+    table[SRE_AX] = { "SRE", Operation::SRE, AddrMode::AbsoluteX, 3, 7, 0, 0, FLAGS_NZC, false };
+    table[SRE_AY] = { "SRE", Operation::SRE, AddrMode::AbsoluteY, 3, 7, 0, 0, FLAGS_NZC, false };
+    table[SRE_IX] = { "SRE", Operation::SRE, AddrMode::IndirectX, 2, 8, 0, 0, FLAGS_NZC, false };
+    table[SRE_IY] = { "SRE", Operation::SRE, AddrMode::IndirectY, 2, 8, 0, 0, FLAGS_NZC, false };
+    table[TAS]    = { "TAS", Operation::TAS, AddrMode::AbsoluteY, 3, 5, 0, 0, 0, false };
+    table[USBC]   = { "SBC", Operation::USBC, AddrMode::Immediate, 2, 2, 0, FLAG_C | FLAG_D, FLAGS_NVZC, false };
+
+    // Null opcodes (NOP)
+    for (byte opcode: { 0x1A, 0x3A, 0x5A, 0x7A, 0xDA, 0xFA })
+    {
+        table[opcode] = { "NOP", Operation::NOP, AddrMode::Implied, 1, 2, 0, 0, 0, false };
+    }
+    for (byte opcode: { 0x80, 0x82, 0x89, 0xC2, 0xE2 })
+    {
+        table[opcode] = { "NOP", Operation::NOP, AddrMode::Immediate, 2, 2, 0, 0, 0, false };
+    }
+    for (byte opcode: { 0x04, 0x44, 0x64 })
+    {
+        table[opcode] = { "NOP", Operation::NOP, AddrMode::Zeropage, 2, 3, 0, 0, 0, false };
+    }
+    for (byte opcode: { 0x14, 0x34, 0x54, 0x74, 0xD4, 0xF4 })
+    {
+        table[opcode] = { "NOP", Operation::NOP, AddrMode::ZeropageX, 2, 4, 0, 0, 0, false };
+    }
+    table[0x0C] = { "NOP", Operation::NOP, AddrMode::Absolute, 3, 4, 0, 0, 0, false };
+    for (byte opcode: { 0x1C, 0x3C, 0x5C, 0x7C, 0xDC, 0xFC })
+    {
+        table[opcode] = { "NOP", Operation::NOP, AddrMode::AbsoluteX, 3, 4, 1, 0, 0, false };
+    }
+
+    // Processor lock-up (JAM)
+    for (byte opcode: { 0x02, 0x12, 0x22, 0x32, 0x42, 0x52, 0x62, 0x72, 0x92, 0xB2, 0xD2, 0xF2 })
+    {
+        table[opcode] = { "JAM", Operation::JAM, AddrMode::Implied, 1, 0, 0, 0, 0, false };
+    }
+
+    return table;
+}();
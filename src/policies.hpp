@@ -0,0 +1,140 @@
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+
+#ifndef NUMBERS_h
+    #include "numbers.hpp"
+    #define NUMBERS_h
+#endif
+
+#ifndef OPCODES_h
+    #include "opcodes.hpp"
+    #define OPCODES_h
+#endif
+
+#ifndef PROFILE_h
+    #include "profile.hpp"
+    #define PROFILE_h
+#endif
+
+#ifndef MEASURE_h
+    #include "measure.hpp"
+    #define MEASURE_h
+#endif
+
+// **** Trace policies ****
+// Called by the core before every instruction, with PC on the opcode
+
+// No tracing, compiles to nothing
+struct NoTrace
+{
+    template <typename Core>
+    void Instruction(const Core&) {}
+};
+
+// Print every instruction and the registers before it runs
+struct PrintTrace
+{
+    std::FILE* out = stderr;
+
+    template <typename Core>
+    void Instruction(const Core& cpu)
+    {
+        std::fprintf(out, "%04X  %02X  A:%02X X:%02X Y:%02X SP:%04X  CYC:%llu\n",
+            (unsigned)cpu.PC, (unsigned)cpu.memory[cpu.PC],
+            (unsigned)cpu.A, (unsigned)cpu.X, (unsigned)cpu.Y,
+            (unsigned)cpu.SP, (unsigned long long)cpu.elapsed());
+    }
+};
+
+// Count block entries and branch outcomes into a profile. Arriving
+// anywhere but after the previous instruction is a block entry; a branch
+// followed by an interrupt counts neither way
+struct ProfileTrace
+{
+    std::shared_ptr<Profile> profile = std::make_shared<Profile>();
+    word next = MEM_SIZE;   // Where falling through from the previous instruction leads
+    word target = MEM_SIZE;     // Where the previous instruction branches to, if it is a branch
+    hword branch = 0;   // Previous instruction
+
+    template <typename Core>
+    void Instruction(const Core& cpu)
+    {
+        if (cpu.PC == target)
+        {
+            profile->taken[branch]++;
+        }
+        else if (cpu.PC == next && target != MEM_SIZE)
+        {
+            profile->not_taken[branch]++;
+        }
+        if (cpu.PC != next)
+        {
+            profile->entries[cpu.PC]++;
+        }
+        const OpcodeEntry& op = opcode_table[cpu.memory[cpu.PC]];
+        branch = cpu.PC;
+        next = (hword)(cpu.PC + op.length);
+        target = op.mode == AddrMode::Relative
+            ? (hword)(next + (std::int8_t)cpu.memory[(hword)(cpu.PC + 1)]) : MEM_SIZE;
+    }
+};
+
+// Time every pass from the start PC to the stop PC into a histogram. A
+// pass runs from the start instruction up to, not including, the stop
+// instruction; start == stop times each round of a loop. Reaching the
+// stop without having passed the start is not counted. The CPU must count
+// cycles
+struct MeasureTrace
+{
+    std::shared_ptr<CycleHistogram> histogram = std::make_shared<CycleHistogram>();
+    word start = MEM_SIZE;  // Where passes start (MEM_SIZE: nowhere)
+    word stop = MEM_SIZE;   // Where passes stop
+    dword began = 0;    // Elapsed cycles when the current pass started
+    bool inside = false;    // In a pass
+
+    template <typename Core>
+    void Instruction(const Core& cpu)
+    {
+        if (cpu.PC == stop && inside)
+        {
+            histogram->Add(cpu.elapsed() - began);
+            inside = false;
+        }
+        if (cpu.PC == start)
+        {
+            began = cpu.elapsed();
+            inside = true;
+        }
+    }
+};
+
+// **** Timing policies ****
+
+// Count every cycle against the budget (required for cycle-bounded runs)
+struct CycleTiming
+{
+    static constexpr bool counts = true;
+};
+
+// No cycle accounting: only instruction-bounded runs are available
+struct NoTiming
+{
+    static constexpr bool counts = false;
+};
+
+// **** Instruction set policies ****
+
+// NMOS 6502, including the illegal opcodes
+struct NMOS6502
+{
+    static constexpr bool Implements(byte) { return true; }
+};
+
+// NMOS 6502, documented opcodes only. Illegal opcodes are treated as
+// undefined and stop the execution
+struct Documented6502
+{
+    static constexpr bool Implements(byte opcode) { return opcode_table[opcode].documented; }
+};
@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <fstream>
+#include <string>
+
+#ifndef PROFILE_h
+    #include "profile.hpp"
+    #define PROFILE_h
+#endif
+
+std::vector<hword> Profile::HotEntries() const
+{
+    std::vector<hword> hot;
+    for (word address = 0; address < MEM_SIZE; address++)
+    {
+        if (entries[address])
+        {
+            hot.push_back(address);
+        }
+    }
+    std::stable_sort(hot.begin(), hot.end(), [this](hword a, hword b) { return entries[a] > entries[b]; });
+    return hot;
+}
+
+bool Profile::Save(const std::filesystem::path& path) const
+{
+    std::ofstream fout(path);
+    for (word address = 0; address < MEM_SIZE; address++)
+    {
+        if (entries[address])
+        {
+            fout << "entry " << address << ' ' << entries[address] << '\n';
+        }
+        if (taken[address] || not_taken[address])
+        {
+            fout << "branch " << address << ' ' << taken[address] << ' ' << not_taken[address] << '\n';
+        }
+    }
+    return !fout.fail();
+}
+
+bool Profile::Load(const std::filesystem::path& path)
+{
+    std::ifstream fin(path);
+    if (fin.fail())
+    {
+        return false;
+    }
+    std::string kind;
+    word address;
+    while (fin >> kind >> address)
+    {
+        address &= 0xFFFF;
+        dword first = 0;
+        dword second = 0;
+        if (kind == "entry" && fin >> first)
+        {
+            entries[address] += first;
+        }
+        else if (kind == "branch" && fin >> first >> second)
+        {
+            taken[address] += first;
+            not_taken[address] += second;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return fin.eof();
+}
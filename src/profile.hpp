@@ -0,0 +1,27 @@
+#include <filesystem>
+#include <vector>
+
+#ifndef NUMBERS_h
+    #include "numbers.hpp"
+    #define NUMBERS_h
+#endif
+
+// **** Profiles ****
+// Where control arrives other than by falling through (block entries) and
+// which way each branch goes, counted over a run by ProfileTrace (see
+// policies.hpp). Saved at the end of a run, a profile tells the recompiler
+// which code to translate besides what it can find, and how to lay it out.
+// Saved profiles are text, one line per address that was seen:
+//   entry <address> <count>
+//   branch <address> <taken> <not taken>
+struct Profile
+{
+    std::vector<dword> entries = std::vector<dword>(MEM_SIZE);  // Block entries at each address
+    std::vector<dword> taken = std::vector<dword>(MEM_SIZE);    // Taken branches at each address
+    std::vector<dword> not_taken = std::vector<dword>(MEM_SIZE);    // Branches not taken at each address
+
+    bool Taken(hword branch) const { return taken[branch] > not_taken[branch]; }   // Mostly taken
+    std::vector<hword> HotEntries() const;  // Entered addresses, hottest first
+    bool Save(const std::filesystem::path&) const;  // false if it could not be written
+    bool Load(const std::filesystem::path&);    // Add a saved profile to this one, false if unreadable
+};
@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <iterator>
+
+#ifndef RECOMPILER_h
+    #include "recompiler.hpp"
+    #define RECOMPILER_h
+#endif
+
+namespace
+{
+    // Enumerator names, as the generated code spells them
+    constexpr const char* operation_names[] = {
+        "Undefined", "ADC", "AND", "ASL", "BCC", "BCS", "BEQ", "BMI", "BNE", "BPL", "BVC", "BVS", "BIT",
+        "BRK", "CLC", "CLD", "CLI", "CLV", "CMP", "CPX", "CPY", "DEC", "DEX", "DEY", "EOR", "INC", "INX",
+        "INY", "JMP", "JSR", "LDA", "LDX", "LDY", "LSR", "NOP", "ORA", "PHA", "PHP", "PLA", "PLP", "ROL",
+        "ROR", "RTI", "RTS", "SBC", "SEC", "SED", "SEI", "STA", "STX", "STY", "TAX", "TAY", "TSX", "TXA",
+        "TXS", "TYA", "ALR", "ANC", "ANE", "ARR", "DCP", "ISC", "LAS", "LAX", "LXA", "RLA", "RRA", "SAX",
+        "SBX", "SHA", "SHX", "SHY", "SLO", "SRE", "TAS", "USBC", "JAM"
+    };
+    static_assert(std::size(operation_names) == (std::size_t)Operation::JAM + 1);
+
+    constexpr const char* mode_names[] = {
+        "Implied", "Accumulator", "Immediate", "Zeropage", "ZeropageX", "ZeropageY",
+        "Absolute", "AbsoluteX", "AbsoluteY", "Indirect", "IndirectX", "IndirectY", "Relative"
+    };
+    static_assert(std::size(mode_names) == (std::size_t)AddrMode::Relative + 1);
+}
+
+std::string Recompile(std::span<const byte> image, hword origin, hword entry, const std::string& name)
+{
+    return Recompile(FindCode(image, origin, entry), entry, name);
+}
+
+std::string Recompile(std::span<const Decoded> code, hword entry, const std::string& name, const Profile* profile)
+{
+    std::vector<BasicBlock> blocks = FindBlocks(code, profile);
+    std::vector<int> index(MEM_SIZE, -1);
+    for (std::size_t i = 0; i < code.size(); i++)
+    {
+        index[code[i].address] = i;
+    }
+
+    // Where control may go after an instruction that transfers, most
+    // likely first: the destination, then the next instruction (after a
+    // branch not taken, a hook or a hypercall)
+    auto successors = [profile](const Decoded& instruction) {
+        hword next = instruction.address + opcode_table[instruction.opcode].length;
+        bool relative = opcode_table[instruction.opcode].mode == AddrMode::Relative;
+        if (relative && profile && !profile->Taken(instruction.address))
+        {
+            return std::array<hword, 2> { next, instruction.target };
+        }
+        return std::array<hword, 2> { instruction.target, next };
+    };
+
+    // Layout: the blocks in address order, or the hottest first, each
+    // followed by the block it mostly leads to
+    std::vector<std::size_t> order;
+    if (profile)
+    {
+        std::vector<dword> heat(blocks.size());
+        std::vector<int> block_at(MEM_SIZE, -1);
+        for (std::size_t r = 0; r < blocks.size(); r++)
+        {
+            block_at[code[blocks[r].begin].address] = r;
+            for (std::size_t i = blocks[r].begin; i < blocks[r].end; i++)
+            {
+                heat[r] += profile->entries[code[i].address];
+            }
+        }
+        std::vector<std::size_t> hottest(blocks.size());
+        for (std::size_t r = 0; r < blocks.size(); r++)
+        {
+            hottest[r] = r;
+        }
+        std::stable_sort(hottest.begin(), hottest.end(), [&heat](std::size_t a, std::size_t b) { return heat[a] > heat[b]; });
+
+        std::vector<bool> placed(blocks.size());
+        for (std::size_t r: hottest)
+        {
+            while (heat[r] && !placed[r])
+            {
+                placed[r] = true;
+                order.push_back(r);
+                int likely = block_at[successors(code[blocks[r].end - 1])[0]];
+                if (likely < 0)
+                {
+                    break;
+                }
+                r = likely;
+            }
+        }
+        for (std::size_t r = 0; r < blocks.size(); r++)
+        {
+            if (!placed[r])
+            {
+                order.push_back(r);
+            }
+        }
+    }
+    else
+    {
+        for (std::size_t r = 0; r < blocks.size(); r++)
+        {
+            order.push_back(r);
+        }
+    }
+
+    // Labels are only emitted where they are jumped to: known destinations,
+    // and blocks that fall through into a block laid out elsewhere
+    auto next_of = [](const Decoded& instruction) { return (hword)(instruction.address + opcode_table[instruction.opcode].length); };
+    auto laid_next = [&](std::size_t p) { return p + 1 < order.size() ? (int)code[blocks[order[p + 1]].begin].address : -1; };
+    std::vector<bool> jumped_to(MEM_SIZE);
+    for (std::size_t p = 0; p < order.size(); p++)
+    {
+        const Decoded& last = code[blocks[order[p]].end - 1];
+        if (last.transfers)
+        {
+            for (hword destination: successors(last))
+            {
+                jumped_to[destination] = index[destination] >= 0;
+            }
+        }
+        else if (laid_next(p) != next_of(last))
+        {
+            jumped_to[next_of(last)] = index[next_of(last)] >= 0;
+        }
+    }
+
+    char line[512];
+    std::string out;
+    std::snprintf(line, sizeof(line),
+        "// Translated by the AF6502 recompiler: %zu instructions reached from $%04X%s.\n",
+        code.size(), entry, profile ? ", laid out by a profile" : "");
+    out += line;
+    out += "// Run it with cpu.run_translated(" + name + ", cycles)\n";
+    out += "#define AF6502_INLINE_CORES    // Instantiate the core here, so that it inlines\n";
+    out += "#ifndef CPU_h\n    #include \"CPU.hpp\"\n    #define CPU_h\n#endif\n\n";
+    out += "#ifndef CPU_TPP_h\n    #include \"CPU.tpp\"\n    #define CPU_TPP_h\n#endif\n\n";
+    out += "bool " + name + "(CPU& cpu)\n{\n";
+    out += "    for (bool first = true; ; first = false)\n    {\n";
+    out += "        switch (cpu.PC)\n        {\n";
+
+    for (std::size_t p = 0; p < order.size(); p++)
+    {
+        std::size_t r = order[p];
+        for (std::size_t i = blocks[r].begin; i < blocks[r].end; i++)
+        {
+            const Decoded& instruction = code[i];
+            const OpcodeEntry& op = opcode_table[instruction.opcode];
+            std::snprintf(line, sizeof(line), "            case 0x%04X:    // %s\n", instruction.address, op.mnemonic);
+            out += line;
+            if (jumped_to[instruction.address])
+            {
+                std::snprintf(line, sizeof(line), "            at_%04X:\n", instruction.address);
+                out += line;
+            }
+            std::snprintf(line, sizeof(line),
+                "                cpu.PC = 0x%04X;\n"
+                "                cpu.Tick();\n"
+                "                cpu.Execute<Operation::%s, AddrMode::%s>();\n",
+                (hword)(instruction.address + 1),
+                operation_names[(std::size_t)op.operation], mode_names[(std::size_t)op.mode]);
+            out += line;
+
+            // A copy or fill loop run natively from here leaves PC past it
+            bool fusable = (op.operation == Operation::LDA || op.operation == Operation::STA)
+                && op.mode == AddrMode::IndirectY;
+            if (fusable)
+            {
+                std::snprintf(line, sizeof(line),
+                    "                if (cpu.cycles <= 0 || cpu.pending || cpu.PC != 0x%04X) return true;\n",
+                    next_of(instruction));
+            }
+            else
+            {
+                std::snprintf(line, sizeof(line), "                if (cpu.cycles <= 0 || cpu.pending) return true;\n");
+            }
+            out += line;
+            if (i + 1 < blocks[r].end || (!instruction.transfers && laid_next(p) == next_of(instruction)))
+            {
+                out += "                [[fallthrough]];\n";
+                continue;
+            }
+            if (!instruction.transfers && jumped_to[next_of(instruction)])
+            {
+                std::snprintf(line, sizeof(line), "                goto at_%04X;\n", next_of(instruction));
+                out += line;
+                continue;
+            }
+
+            // End of the run: straight to the translated destination,
+            // otherwise back to the switch with the new PC
+            std::array<hword, 2> destinations = successors(instruction);
+            for (int d = 0; d < 2; d++)
+            {
+                if (jumped_to[destinations[d]] && (d == 0 || destinations[1] != destinations[0]))
+                {
+                    std::snprintf(line, sizeof(line),
+                        "                if (cpu.PC == 0x%04X) goto at_%04X;\n", destinations[d], destinations[d]);
+                    out += line;
+                }
+            }
+            out += "                break;\n";
+        }
+    }
+
+    out += "            default:\n";
+    out += "                return !first;  // Not translated: over to the interpreter\n";
+    out += "        }\n    }\n}\n";
+    return out;
+}
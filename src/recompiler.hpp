@@ -0,0 +1,39 @@
+#include <span>
+#include <string>
+
+#ifndef NUMBERS_h
+    #include "numbers.hpp"
+    #define NUMBERS_h
+#endif
+
+#ifndef ANALYSIS_h
+    #include "analysis.hpp"
+    #define ANALYSIS_h
+#endif
+
+#ifndef PROFILE_h
+    #include "profile.hpp"
+    #define PROFILE_h
+#endif
+
+// **** Static recompiler ****
+// Translates fixed firmware to C++ ahead of time. The output defines
+//   bool <name>(CPU& cpu)
+// to be compiled and linked against the AF6502 library, and run with
+// cpu.run_translated(<name>, cycles). Every instruction reached from the
+// entry point becomes a case of a switch on PC that calls the core's own
+// handler directly, so registers, flags, memory and cycles come out the
+// same as interpreting it. Opcode fetches and dispatch are gone, and the
+// core inlines into the translation; operands are still read from memory.
+// Code the traversal cannot see (targets of indirect jumps, interrupt
+// handlers, code written at run time) is left to the interpreter. The
+// opcodes are fixed at translation time: code that rewrites its own
+// opcodes must not be translated
+
+// C++ source of the translation of the code reached from entry. Basic
+// blocks are kept together, and known destinations are jumped to directly
+// instead of through the switch. A profile orders the blocks hottest
+// first, each followed by the one it mostly leads to
+std::string Recompile(std::span<const byte> image, hword origin, hword entry, const std::string& name);
+std::string Recompile(std::span<const Decoded> code, hword entry, const std::string& name,
+    const Profile* profile = nullptr);  // Code found already
@@ -0,0 +1,132 @@
+#include <exception>
+#include <thread>
+#include <utility>
+
+#ifndef SCHEDULER_h
+    #include "scheduler.hpp"
+    #define SCHEDULER_h
+#endif
+
+Task Task::promise_type::get_return_object()
+{
+    return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+}
+
+std::suspend_always Task::promise_type::initial_suspend() noexcept
+{
+    return {};
+}
+
+std::suspend_always Task::promise_type::final_suspend() noexcept
+{
+    return {};
+}
+
+void Task::promise_type::return_void()
+{
+}
+
+void Task::promise_type::unhandled_exception()
+{
+    // Emulations have nobody to report to on a worker thread
+    std::terminate();
+}
+
+Task::Task(std::coroutine_handle<promise_type> h) : handle(h)
+{
+}
+
+Task::Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr))
+{
+}
+
+Task& Task::operator=(Task&& other) noexcept
+{
+    if (this != &other)
+    {
+        if (handle)
+        {
+            handle.destroy();
+        }
+        handle = std::exchange(other.handle, nullptr);
+    }
+    return *this;
+}
+
+Task::~Task()
+{
+    if (handle)
+    {
+        handle.destroy();
+    }
+}
+
+bool Task::done() const
+{
+    return !handle || handle.done();
+}
+
+void Task::resume()
+{
+    handle.resume();
+}
+
+void Scheduler::spawn(Task task)
+{
+    tasks.push_back(std::move(task));
+}
+
+// Resume every Task in turn until all of them are done
+static void round_robin(std::vector<Task>& queue)
+{
+    while (!queue.empty())
+    {
+        std::size_t alive = 0;
+        for (std::size_t i = 0; i < queue.size(); i++)
+        {
+            queue[i].resume();
+            if (!queue[i].done())
+            {
+                if (alive != i)
+                {
+                    queue[alive] = std::move(queue[i]);
+                }
+                alive++;
+            }
+        }
+        queue.erase(queue.begin() + alive, queue.end());
+    }
+}
+
+void Scheduler::run(unsigned threads)
+{
+    if (threads <= 1 || tasks.size() <= 1)
+    {
+        round_robin(tasks);
+        return;
+    }
+
+    // Deal the Tasks out to one queue per thread
+    std::vector<std::vector<Task>> queues(threads);
+    for (std::size_t i = 0; i < tasks.size(); i++)
+    {
+        queues[i % threads].push_back(std::move(tasks[i]));
+    }
+    tasks.clear();
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; t++)
+    {
+        workers.emplace_back(round_robin, std::ref(queues[t]));
+    }
+    round_robin(queues[0]);
+    for (std::thread& worker: workers)
+    {
+        worker.join();
+    }
+}
+
+std::size_t Scheduler::size() const
+{
+    return tasks.size();
+}
@@ -0,0 +1,78 @@
+#include <coroutine>
+#include <limits>
+#include <vector>
+
+#ifndef NUMBERS_h
+    #include "numbers.hpp"
+    #define NUMBERS_h
+#endif
+
+#ifndef CPU_h
+    #include "CPU.hpp"
+    #define CPU_h
+#endif
+
+// Suspension point for a Task: co_await Yield{} hands control back to the
+// scheduler, which resumes the next Task in its round
+using Yield = std::suspend_always;
+
+// Cooperatively scheduled emulation, as a C++20 coroutine. Tasks start
+// suspended and only run when resumed by their Scheduler
+class Task
+{
+    public:
+    struct promise_type
+    {
+        Task get_return_object();
+        std::suspend_always initial_suspend() noexcept;
+        std::suspend_always final_suspend() noexcept;
+        void return_void();
+        void unhandled_exception();
+    };
+
+    Task(Task&&) noexcept;
+    Task& operator=(Task&&) noexcept;
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task();
+
+    bool done() const;  // True once the coroutine has returned
+    void resume();  // Run the coroutine up to its next Yield
+
+    private:
+    explicit Task(std::coroutine_handle<promise_type>);
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Run the CPU in slices of `quantum` cycles, yielding after each slice,
+// until `max_cycles` have elapsed. A quantum of 0 runs up to `max_cycles`
+// without yielding in between. The CPU must outlive the Task
+template <typename Core>
+Task run_async(Core& cpu, word quantum, dword max_cycles)
+{
+    constexpr word largest = std::numeric_limits<sword>::max();     // Most a slice can hold
+    word slice = (quantum == 0 || quantum > largest) ? largest : quantum;
+    while (cpu.elapsed() < max_cycles)
+    {
+        dword left = max_cycles - cpu.elapsed();
+        cpu.run_for_cycles(left < slice ? (word)left : slice);
+        if (quantum != 0)
+        {
+            co_await Yield{};
+        }
+    }
+}
+
+// Round-robin scheduler for many Tasks on a small pool of host threads.
+// Tasks are split evenly between the threads up front, so switching from
+// one emulator to the next is just a coroutine resume, with no locking
+class Scheduler
+{
+    private:
+    std::vector<Task> tasks;
+
+    public:
+    void spawn(Task task);  // Add a Task to the next run
+    void run(unsigned threads = 1); // Run all Tasks to completion
+    std::size_t size() const;   // Number of Tasks waiting to run
+};
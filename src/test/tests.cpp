@@ -1,3 +1,6 @@
+#include <filesystem>
+#include <fstream>
+#include <iterator>
 #include <gtest/gtest.h>
 
 #ifndef MEMORY_h
@@ -5,11 +8,51 @@
     #define MEMORY_h
 #endif
 
+#ifndef DEVICES_h
+    #include "../devices.hpp"
+    #define DEVICES_h
+#endif
+
 #ifndef CPU_h
     #include "../CPU.hpp"
     #define CPU_h
 #endif
 
+#ifndef CPU_TPP_h
+    #include "../CPU.tpp"
+    #define CPU_TPP_h
+#endif
+
+#ifndef SCHEDULER_h
+    #include "../scheduler.hpp"
+    #define SCHEDULER_h
+#endif
+
+#ifndef ANALYSIS_h
+    #include "../analysis.hpp"
+    #define ANALYSIS_h
+#endif
+
+#ifndef RECOMPILER_h
+    #include "../recompiler.hpp"
+    #define RECOMPILER_h
+#endif
+
+#ifndef CACHE_h
+    #include "../cache.hpp"
+    #define CACHE_h
+#endif
+
+#ifndef PROFILE_h
+    #include "../profile.hpp"
+    #define PROFILE_h
+#endif
+
+#ifndef ESTIMATOR_h
+    #include "../estimator.hpp"
+    #define ESTIMATOR_h
+#endif
+
 TEST(AF6502Tests, DemonstrateGTestMacro)
 {
     EXPECT_EQ(true, true);
@@ -354,14 +397,14 @@ TEST(AF6502Tests, BranchTest)
 TEST(AF6502Tests, BITTest)
 {
     // Create CPU
-    CPU cpu(1);
+    CPU cpu(0);
     
     cpu.A = 0x3B;
     cpu.BIT(0x8C);
     EXPECT_EQ(cpu.Z, false);    // A & operand != 0
     EXPECT_EQ(cpu.N, true);     // operand's MSB is 1
     EXPECT_EQ(cpu.V, false);    // operand's 6th bit is 0
-    EXPECT_EQ(cpu.cycles, 0);   // 1 cycle consumed
+    EXPECT_EQ(cpu.cycles, 0);   // No cycles consumed: the operand read is the last one
 }
 
 // Compare test
@@ -437,10 +480,19 @@ TEST(AF6502Tests, DECTest)
     // Create CPU
     CPU cpu(3);
    
-    cpu.memory.WriteByte(0xAEAB, 0x03);
-    cpu.DEC(cpu.memory.ReadByte(0xAEAB), 0xAEAB);
-    EXPECT_EQ(cpu.memory.ReadByte(0xAEAB), 0x03);
-    EXPECT_EQ(cpu.cycles, 0);   // 3 cycles consumed
+    // DEC $AEAB, DEC $AEAB
+    std::vector<byte> program = { 0xCE, 0xAB, 0xAE, 0xCE, 0xAB, 0xAE };
+    cpu.memory.WriteProgram(program, 0x0200);
+    cpu.memory.WriteByte(0xAEAB, 0x01);
+    cpu.PC = 0x0200;
+    cpu.run_for_instructions(1);
+    EXPECT_EQ(cpu.memory.ReadByte(0xAEAB), 0x00);
+    EXPECT_EQ(cpu.Z, true);
+    EXPECT_EQ(cpu.N, false);
+    cpu.run_for_instructions(1);
+    EXPECT_EQ(cpu.memory.ReadByte(0xAEAB), 0xFF);
+    EXPECT_EQ(cpu.Z, false);
+    EXPECT_EQ(cpu.N, true);
 }
 
 // Decrement test
@@ -486,10 +538,19 @@ TEST(AF6502Tests, INCTest)
     // Create CPU
     CPU cpu(3);
    
-    cpu.memory.WriteByte(0xAEEB, 0x03);
-    cpu.INC(cpu.memory.ReadByte(0xAEEB), 0xAEEB);
-    EXPECT_EQ(cpu.memory.ReadByte(0xAEEB), 0x04);
-    EXPECT_EQ(cpu.cycles, 0);   // 3 cycles consumed
+    // INC $AEEB, INC $AEEB, with A non-zero
+    std::vector<byte> program = { 0xEE, 0xEB, 0xAE, 0xEE, 0xEB, 0xAE };
+    cpu.memory.WriteProgram(program, 0x0200);
+    cpu.memory.WriteByte(0xAEEB, 0xFF);
+    cpu.A = 0x12;
+    cpu.PC = 0x0200;
+    cpu.run_for_instructions(1);
+    EXPECT_EQ(cpu.memory.ReadByte(0xAEEB), 0x00);
+    EXPECT_EQ(cpu.Z, true);     // From the result, not from A
+    cpu.run_for_instructions(1);
+    EXPECT_EQ(cpu.memory.ReadByte(0xAEEB), 0x01);
+    EXPECT_EQ(cpu.Z, false);
+    EXPECT_EQ(cpu.N, false);
 }
 
 // Increment test
@@ -539,7 +600,7 @@ TEST(AF6502Tests, LDTest)
 TEST(AF6502Tests, LSRTest)
 {
 
-    CPU cpu(2); // Create CPU
+    CPU cpu(1); // Create CPU
 
     cpu.A = 0x5B;
     cpu.A = cpu.LSR(cpu.A);
@@ -547,7 +608,7 @@ TEST(AF6502Tests, LSRTest)
     EXPECT_EQ(cpu.C, true);     // LSB = 1 (carried out)
     EXPECT_EQ(cpu.N, false);    // MSB (post-shift) = 0 (always)
     EXPECT_EQ(cpu.Z, false);    // non-negative result
-    EXPECT_EQ(cpu.cycles, 0);   // 2 cycles consumed
+    EXPECT_EQ(cpu.cycles, 0);   // 1 cycle consumed
 }
 
 // ORA test
@@ -769,9 +830,1674 @@ TEST(AF6502Tests, SRETest)
     EXPECT_EQ(0, cpu.cycles);   // Check cycles consumption
 }
 
+// Resumable execution test
+TEST(AF6502Tests, ResumableExecutionTest)
+{
+    // LDA #$05, ADC #$03, TAX, INX, STA $0300, LDY #$07, INY, JMP $0200
+    std::vector<byte> program = {
+        0xA9, 0x05, 0x69, 0x03, 0xAA, 0xE8, 0x8D, 0x00,
+        0x03, 0xA0, 0x07, 0xC8, 0x4C, 0x00, 0x02
+    };
+
+    // Reference run, all cycles at once
+    CPU reference(1000);
+    reference.memory.WriteProgram(program, 0x0200);
+    reference.execute(0x0200);
+
+    // Same program, run in 8-cycle slices
+    CPU sliced(0);
+    sliced.memory.WriteProgram(program, 0x0200);
+    sliced.PC = 0x0200;
+    for (int i = 0; i < 1000 / 8; i++)
+    {
+        sliced.run_for_cycles(8);
+    }
+
+    EXPECT_EQ(reference.PC, sliced.PC);
+    EXPECT_EQ(reference.A, sliced.A);
+    EXPECT_EQ(reference.X, sliced.X);
+    EXPECT_EQ(reference.Y, sliced.Y);
+    EXPECT_EQ(reference.cycles, sliced.cycles);    // Same overshoot carried
+    EXPECT_EQ(reference.elapsed(), sliced.elapsed());
+}
+
+// Stepping test
+TEST(AF6502Tests, SteppingTest)
+{
+    // LDA #$05, ADC #$03, TAX, INX, STA $0300, LDY #$07, INY, JMP $0200
+    std::vector<byte> program = {
+        0xA9, 0x05, 0x69, 0x03, 0xAA, 0xE8, 0x8D, 0x00,
+        0x03, 0xA0, 0x07, 0xC8, 0x4C, 0x00, 0x02
+    };
+
+    // Create CPU
+    CPU cpu(0);
+    cpu.memory.WriteProgram(program, 0x0200);
+    cpu.PC = 0x0200;
+
+    // LDA #$05
+    EXPECT_EQ(cpu.step(), 2);
+    EXPECT_EQ(cpu.PC, 0x0202);
+    EXPECT_EQ(cpu.A, 0x05);
+
+    // ADC #$03, TAX
+    EXPECT_EQ(cpu.run_for_instructions(2), 4);
+    EXPECT_EQ(cpu.X, 0x08);
+
+    // Stop on STA $0300, before executing it
+    EXPECT_EQ(cpu.run_until(0x0206, 100), true);
+    EXPECT_EQ(cpu.PC, 0x0206);
+    EXPECT_EQ(cpu.X, 0x09);
+    EXPECT_EQ(cpu.memory.ReadByte(0x0300), 0x00);
+    EXPECT_EQ(cpu.cycles, 0);   // Stepping debt paid, leftover handed back
+    EXPECT_EQ(cpu.elapsed(), 8);
+
+    // Address never reached within the cycle budget
+    EXPECT_EQ(cpu.run_until(0x0400, 20), false);
+    EXPECT_EQ(cpu.memory.ReadByte(0x0300), 0x08);
+}
+
+// Policy configurations test
+TEST(AF6502Tests, CoreConfigurationsTest)
+{
+    // LDA #$05, ADC #$03, TAX, INX, STA $0300, LDY #$07, INY, JMP $0200
+    std::vector<byte> program = {
+        0xA9, 0x05, 0x69, 0x03, 0xAA, 0xE8, 0x8D, 0x00,
+        0x03, 0xA0, 0x07, 0xC8, 0x4C, 0x00, 0x02
+    };
+
+    // Default core
+    CPU cpu(0);
+    cpu.memory.WriteProgram(program, 0x0200);
+    cpu.PC = 0x0200;
+    cpu.run_for_instructions(20);
+
+    // No cycle accounting: same results, no cycles consumed
+    FuzzCPU fuzz(0);
+    fuzz.memory.WriteProgram(program, 0x0200);
+    fuzz.PC = 0x0200;
+    EXPECT_EQ(fuzz.run_for_instructions(20), 0);
+    EXPECT_EQ(fuzz.PC, cpu.PC);
+    EXPECT_EQ(fuzz.A, cpu.A);
+    EXPECT_EQ(fuzz.X, cpu.X);
+    EXPECT_EQ(fuzz.Y, cpu.Y);
+    EXPECT_EQ(fuzz.elapsed(), 0);
+
+    // Unused tracer takes no space
+    EXPECT_EQ(sizeof(FuzzCPU), sizeof(CPU));
+
+    // Tracing core: one line per instruction
+    DebugCPU debug(0);
+    debug.trace.out = std::tmpfile();
+    debug.memory.WriteProgram(program, 0x0200);
+    debug.PC = 0x0200;
+    debug.run_for_instructions(3);
+    EXPECT_EQ(debug.X, 0x08);
+    std::rewind(debug.trace.out);
+    char line[128];
+    int lines = 0;
+    while (std::fgets(line, sizeof(line), debug.trace.out))
+    {
+        lines++;
+    }
+    EXPECT_EQ(lines, 3);
+    std::fclose(debug.trace.out);
+
+    // Documented opcodes only: LAX $10 stops the execution
+    DocumentedCPU documented(100);
+    std::vector<byte> illegal = { 0xA9, 0x05, 0xA7, 0x10, 0xE8 };
+    documented.memory.WriteProgram(illegal, 0x0200);
+    documented.execute(0x0200);
+    EXPECT_EQ(documented.A, 0x05);
+    EXPECT_EQ(documented.X, 0x00);
+    EXPECT_EQ(documented.PC, 0x0203);
+}
+
+// Generated opcode handlers test
+TEST(AF6502Tests, OpcodeHandlersTest)
+{
+    // Every opcode has a handler
+    for (int opcode = 0; opcode < 256; opcode++)
+    {
+        EXPECT_NE(CPU::handlers[opcode], nullptr);
+    }
+
+    // Illegal opcodes share the undefined handler when left out
+    EXPECT_EQ(DocumentedCPU::handlers[LAX_ZP], DocumentedCPU::handlers[0x02]);
+    EXPECT_NE(CPU::handlers[LAX_ZP], CPU::handlers[0x02]);
+
+    std::vector<byte> program = {
+        0xA2, 0x03,         // LDX #$03
+        0xA9, 0x41,         // LDA #$41
+        0x9D, 0x10, 0x03,   // STA $0310,X
+        0x1E, 0x10, 0x03,   // ASL $0310,X
+        0xA9, 0x81,         // LDA #$81
+        0x85, 0x10,         // STA $10
+        0x38,               // SEC
+        0x26, 0x10,         // ROL $10
+        0x86, 0x11,         // STX $11
+        0x20, 0x40, 0x02,   // JSR $0240
+        0xCA,               // DEX
+        0xD0, 0xFD,         // BNE -3
+        0x02                // JAM
+    };
+    std::vector<byte> subroutine = {
+        0xA0, 0x07,         // LDY #$07
+        0x48,               // PHA
+        0x68,               // PLA
+        0x60                // RTS
+    };
+
+    // Create CPU
+    CPU cpu(1000);
+    cpu.memory.WriteProgram(program, 0x0200);
+    cpu.memory.WriteProgram(subroutine, 0x0240);
+    cpu.execute(0x0200);
+
+    EXPECT_EQ(cpu.PC, 0x0219);  // Stuck on the JAM
+    EXPECT_EQ(cpu.memory.ReadByte(0x0313), 0x82);   // ASL on memory
+    EXPECT_EQ(cpu.memory.ReadByte(0x10), 0x03);     // ROL with carry in
+    EXPECT_EQ(cpu.memory.ReadByte(0x11), 0x03);     // STX
+    EXPECT_EQ(cpu.memory.ReadByte(0x0100), 0x02);   // Return address, high
+    EXPECT_EQ(cpu.memory.ReadByte(0x01FF), 0x15);   // Return address, low
+    EXPECT_EQ(cpu.A, 0x81);
+    EXPECT_EQ(cpu.X, 0x00);     // Backward branch looped down to 0
+    EXPECT_EQ(cpu.Y, 0x07);
+    EXPECT_EQ(cpu.Z, true);
+}
+
+// Cooperative scheduling test
+TEST(AF6502Tests, SchedulerTest)
+{
+    // LDA #$05, ADC #$03, TAX, INX, STA $0300, LDY #$07, INY, JMP $0200
+    std::vector<byte> program = {
+        0xA9, 0x05, 0x69, 0x03, 0xAA, 0xE8, 0x8D, 0x00,
+        0x03, 0xA0, 0x07, 0xC8, 0x4C, 0x00, 0x02
+    };
+
+    // Reference run, all cycles at once
+    CPU reference(1000);
+    reference.memory.WriteProgram(program, 0x0200);
+    reference.execute(0x0200);
+
+    // Many instances sharing four host threads, 16 cycles at a time
+    std::vector<CPU> cpus(64, CPU(0));
+    Scheduler scheduler;
+    for (CPU& cpu: cpus)
+    {
+        cpu.memory.WriteProgram(program, 0x0200);
+        cpu.PC = 0x0200;
+        scheduler.spawn(run_async(cpu, 16, 1000));
+    }
+    EXPECT_EQ(scheduler.size(), 64);
+    scheduler.run(4);
+    EXPECT_EQ(scheduler.size(), 0);
+
+    for (CPU& cpu: cpus)
+    {
+        EXPECT_EQ(cpu.PC, reference.PC);
+        EXPECT_EQ(cpu.A, reference.A);
+        EXPECT_EQ(cpu.X, reference.X);
+        EXPECT_EQ(cpu.elapsed(), reference.elapsed());
+    }
+
+    // A quantum of 0 runs the whole budget in one go
+    CPU whole(0);
+    whole.memory.WriteProgram(program, 0x0200);
+    whole.PC = 0x0200;
+    scheduler.spawn(run_async(whole, 0, 1000));
+    scheduler.run();
+    EXPECT_EQ(scheduler.size(), 0);
+    EXPECT_EQ(whole.PC, reference.PC);
+    EXPECT_EQ(whole.elapsed(), reference.elapsed());
+}
+
+// Opcode metadata test
+TEST(AF6502Tests, OpcodeMetadataTest)
+{
+    // Every opcode is described, with a length that matches its mode
+    int documented = 0;
+    for (int opcode = 0; opcode < 256; opcode++)
+    {
+        const OpcodeEntry& entry = opcode_table[opcode];
+        EXPECT_NE(entry.mnemonic, nullptr);
+        EXPECT_GE(entry.length, 1);
+        EXPECT_LE(entry.length, 3);
+        documented += entry.documented;
+    }
+    EXPECT_EQ(documented, 151);
+
+    // Spot checks against the NMOS timing and flag tables
+    EXPECT_STREQ(opcode_table[LDA_AX].mnemonic, "LDA");
+    EXPECT_EQ(opcode_table[LDA_AX].length, 3);
+    EXPECT_EQ(opcode_table[LDA_AX].cycles, 4);
+    EXPECT_EQ(opcode_table[LDA_AX].page_penalty, 1);
+    EXPECT_EQ(opcode_table[STA_AX].cycles, 5);
+    EXPECT_EQ(opcode_table[STA_AX].page_penalty, 0);
+    EXPECT_EQ(opcode_table[INC_AX].cycles, 7);
+    EXPECT_EQ(opcode_table[JMP_IN].cycles, 5);
+    EXPECT_EQ(opcode_table[BNE].mode, AddrMode::Relative);
+    EXPECT_EQ(opcode_table[BNE].flags_read, FLAG_Z);
+    EXPECT_EQ(opcode_table[ADC_IM].flags_read, FLAG_C | FLAG_D);
+    EXPECT_EQ(opcode_table[ADC_IM].flags_written, FLAGS_NVZC);
+    EXPECT_EQ(opcode_table[STA_ZP].flags_written, 0);
+    EXPECT_FALSE(opcode_table[LAX_ZP].documented);
+    EXPECT_FALSE(opcode_table[0x1A].documented);
+
+    // The documented instruction set policy follows the table
+    EXPECT_TRUE(Documented6502::Implements(LDA_IM));
+    EXPECT_FALSE(Documented6502::Implements(SLO_ZP));
+}
+
+// Opcode timing test
+TEST(AF6502Tests, OpcodeTimingTest)
+{
+    // One documented instruction at a time, operands at $3010 (or through
+    // the pointer at $10), indexed by 0 or by $FF to cross a page
+    auto measure = [](byte opcode, byte index, bool flags, hword at, byte offset) {
+        CPU cpu(0);
+        std::vector<byte> instruction = { opcode, offset, 0x30 };
+        cpu.memory.WriteProgram(instruction, at);
+        cpu.memory.WriteByte(0x10, 0x10);
+        cpu.memory.WriteByte(0x11, 0x30);
+        cpu.X = cpu.Y = index;
+        cpu.C = cpu.Z = cpu.N = cpu.V = flags;
+        cpu.SP = 0xF0;
+        cpu.PC = at;
+        cpu.run_for_instructions(1);
+        return cpu.elapsed();
+    };
+
+    for (int opcode = 0; opcode < 256; opcode++)
+    {
+        const OpcodeEntry& entry = opcode_table[opcode];
+        if (!entry.documented)
+        {
+            continue;
+        }
+        if (entry.mode == AddrMode::Relative)
+        {
+            // Not taken, taken, taken across a page
+            bool taken = (opcode & 0x20) != 0;  // Flag value the branch is taken on
+            EXPECT_EQ(measure(opcode, 0, !taken, 0x0200, 0x10), entry.cycles) << entry.mnemonic;
+            EXPECT_EQ(measure(opcode, 0, taken, 0x0200, 0x10), entry.cycles + entry.page_penalty) << entry.mnemonic;
+            EXPECT_EQ(measure(opcode, 0, taken, 0x02F0, 0x7F), entry.cycles + entry.page_penalty + 1) << entry.mnemonic;
+            continue;
+        }
+        EXPECT_EQ(measure(opcode, 0, false, 0x0200, 0x10), entry.cycles) << entry.mnemonic << " " << opcode;
+        if (entry.mode == AddrMode::AbsoluteX || entry.mode == AddrMode::AbsoluteY ||
+            entry.mode == AddrMode::IndirectY)
+        {
+            EXPECT_EQ(measure(opcode, 0xFF, false, 0x0200, 0x10), entry.cycles + entry.page_penalty)
+                << entry.mnemonic << " " << opcode;
+        }
+    }
+}
+
+// Address space test
+TEST(AF6502Tests, AddressSpaceTest)
+{
+    // Create CPU
+    CPU cpu(0);
+
+    // The whole 64 KiB space is addressable, $FFFF included
+    cpu.memory.WriteByte(0xFFFF, 0x42);
+    EXPECT_EQ(cpu.memory[0xFFFF], 0x42);
+    EXPECT_EQ(cpu.memory.ReadWord(0xFFFE), 0x4200);
+
+    // Operands that run past $FFFF wrap around to $0000
+    std::vector<byte> program = { 0xAD, 0x34 };     // LDA $xx34
+    cpu.memory.WriteProgram(program, 0xFFFE);
+    cpu.memory.WriteByte(0x0000, 0x12);                 // high byte, wrapped
+    cpu.memory.WriteByte(0x1234, 0x99);
+    EXPECT_EQ(cpu.memory.ReadWord(0xFFFF), 0x1234);
+    cpu.PC = 0xFFFE;
+    cpu.run_for_instructions(1);
+    EXPECT_EQ(cpu.A, 0x99);
+    EXPECT_EQ(cpu.PC, 0x0001);
+    EXPECT_EQ(cpu.elapsed(), 4);
+}
+
+// Lazy memory test
+TEST(AF6502Tests, LazyMemoryTest)
+{
+    // Create CPU
+    CPU cpu(100);
+
+    // Nothing is allocated until it is written
+    EXPECT_EQ(cpu.memory.PrivatePages(), 0);
+    EXPECT_EQ(cpu.memory[0x1234], 0x00);
+    EXPECT_EQ(cpu.memory.ReadWord(0xFFFF), 0x0000);
+    EXPECT_EQ(cpu.memory.PrivatePages(), 0);
+    EXPECT_LT(sizeof(Memory), 8 * 1024);
+
+    // Writes materialize one page at a time, reads do not
+    std::vector<byte> program = { 0xA9, 0x05, 0x8D, 0x00, 0x03, 0xAD, 0x00, 0x40, 0x02 };
+    cpu.memory.WriteProgram(program, 0x0200);
+    EXPECT_EQ(cpu.memory.PrivatePages(), 1);
+    cpu.execute(0x0200);
+    EXPECT_EQ(cpu.memory[0x0300], 0x05);
+    EXPECT_EQ(cpu.A, 0x00);
+    EXPECT_EQ(cpu.memory.PrivatePages(), 2);
+
+    // Copies own their pages
+    Memory copy = cpu.memory;
+    copy.WriteByte(0x0300, 0x06);
+    EXPECT_EQ(cpu.memory[0x0300], 0x05);
+    EXPECT_EQ(copy.PrivatePages(), 2);
+
+    // A word read across a page boundary
+    cpu.memory.WriteByte(0x02FF, 0x34);
+    cpu.memory.WriteByte(0x0300, 0x12);
+    EXPECT_EQ(cpu.memory.ReadWord(0x02FF), 0x1234);
+
+    cpu.memory.init();
+    EXPECT_EQ(cpu.memory.PrivatePages(), 0);
+    EXPECT_EQ(cpu.memory[0x0300], 0x00);
+}
+
+// Shared image test
+TEST(AF6502Tests, SharedImageTest)
+{
+    // Load the program once
+    std::vector<byte> program = {
+        0xAD, 0x00, 0x21,   // LDA $2100
+        0x8D, 0x00, 0x03,   // STA $0300
+        0xEE, 0x00, 0x21,   // INC $2100 (ROM, ignored)
+        0x02                // JAM
+    };
+    program.resize(0x100 + 1, 0x00);
+    program[0x100] = 0x2A;  // $2100
+    auto image = std::make_shared<const Image>(program, 0x2000);
+    EXPECT_EQ(image->FirstPage(), 0x20);
+    EXPECT_EQ(image->Pages(), 2);
+
+    // Create CPUs
+    std::vector<CPU> cpus(4, CPU(100));
+    for (CPU& cpu: cpus)
+    {
+        cpu.memory.MapImage(image);
+        EXPECT_EQ(cpu.memory.PrivatePages(), 0);
+        cpu.execute(0x2000);
+        EXPECT_EQ(cpu.memory[0x0300], 0x2A);
+        EXPECT_EQ(cpu.memory[0x2100], 0x2A);
+        EXPECT_EQ(cpu.memory.PrivatePages(), 1);
+    }
+    EXPECT_EQ(image.use_count(), 5);
+
+    // Writes never reach the image
+    cpus[0].memory.WriteByte(0x2000, 0xEA);
+    EXPECT_EQ(cpus[0].memory[0x2000], 0xAD);
+    EXPECT_EQ(image->PageData(0)[0], 0xAD);
+}
+
+// Baseline restore test
+TEST(AF6502Tests, BaselineRestoreTest)
+{
+    // Create CPU
+    CPU cpu(0);
+
+    // Program: copy the input at $10 to $0400, count the runs at $0500
+    std::vector<byte> program = {
+        0xA5, 0x10,         // LDA $10
+        0x8D, 0x00, 0x04,   // STA $0400
+        0xEE, 0x00, 0x05,   // INC $0500
+        0x02                // JAM
+    };
+    cpu.memory.WriteProgram(program, 0x0200);
+    cpu.memory.WriteByte(0x0500, 0x07);
+    cpu.memory.SetBaseline();
+    EXPECT_EQ(cpu.memory.PrivatePages(), 0);
+    EXPECT_EQ(cpu.memory.DirtyPages(), 0);
+
+    for (byte input = 1; input <= 3; input++)
+    {
+        cpu.memory.WriteByte(0x0010, input);
+        cpu.PC = 0x0200;
+        cpu.run_for_cycles(100);
+        EXPECT_EQ(cpu.memory[0x0400], input);
+        EXPECT_EQ(cpu.memory[0x0500], 0x08);
+        EXPECT_EQ(cpu.memory.DirtyPages(), 3);
+
+        // Only the written pages go back
+        cpu.memory.Restore();
+        cpu.reset();
+        EXPECT_EQ(cpu.memory.DirtyPages(), 0);
+        EXPECT_EQ(cpu.memory.PrivatePages(), 0);
+        EXPECT_EQ(cpu.memory[0x0010], 0x00);
+        EXPECT_EQ(cpu.memory[0x0400], 0x00);
+        EXPECT_EQ(cpu.memory[0x0500], 0x07);
+        EXPECT_EQ(cpu.memory[0x0200], 0xA5);
+    }
+
+    // Copies share the baseline
+    Memory copy = cpu.memory;
+    copy.WriteByte(0x0200, 0xEA);
+    copy.Restore();
+    EXPECT_EQ(copy[0x0200], 0xA5);
+
+    // Without a baseline, written RAM goes blank; images and devices stay
+    std::vector<byte> rom = { 0x4C, 0x00, 0xE0 };
+    Memory bare(std::make_shared<Image>(rom, 0xE000));
+    auto mapper = std::make_shared<BankMapper>(0x8000, 0x100, 2, false);
+    std::vector<byte> bank = { 0x42 };
+    mapper->Load(bank, 0x100);
+    bare.Attach(mapper, 0xF000, 0xF000);
+    bare.WriteByte(0xF000, 1);
+    bare.WriteByte(0x0300, 0x55);
+    bare.Restore();
+    EXPECT_EQ(bare[0x0300], 0x00);
+    EXPECT_EQ(bare.PrivatePages(), 0);
+    EXPECT_EQ(bare[0xE000], 0x4C);
+    EXPECT_EQ(bare[0x8000], 0x42);
+    EXPECT_EQ(bare[0xF000], 1);
+    bare.WriteByte(0xF000, 0);
+    EXPECT_EQ(bare[0x8000], 0x00);
+}
+
+// Memory that counts its copies
+struct CountingMemory : Memory
+{
+    static inline int copies = 0;
+
+    using Memory::Memory;
+    CountingMemory() = default;
+    CountingMemory(const CountingMemory& other) : Memory(other) { copies++; }
+    CountingMemory(CountingMemory&&) = default;
+    CountingMemory& operator=(const CountingMemory& other) { Memory::operator=(other); copies++; return *this; }
+    CountingMemory& operator=(CountingMemory&&) = default;
+};
+
+// No memory copies test
+TEST(AF6502Tests, NoMemoryCopiesTest)
+{
+    std::vector<byte> program = { 0xA9, 0x05, 0x8D, 0x00, 0x03, 0x02 };
+    auto image = std::make_shared<const Image>(program, 0x0200);
+
+    // Memory moved into the core
+    CountingMemory memory;
+    memory.WriteProgram(program, 0x0200);
+    Core<CountingMemory, NoTrace, CycleTiming, NMOS6502> moved(100, std::move(memory));
+    moved.execute(0x0200);
+    EXPECT_EQ(moved.memory[0x0300], 0x05);
+
+    // Memory built around a shared image
+    Core<CountingMemory, NoTrace, CycleTiming, NMOS6502> shared(100, CountingMemory(image));
+    shared.execute(0x0200);
+    EXPECT_EQ(shared.memory[0x0300], 0x05);
+    EXPECT_EQ(shared.memory.PrivatePages(), 1);
+
+    // Memory borrowed for reading
+    const Memory& borrowed = shared.memory;
+    EXPECT_EQ(borrowed[0x0200], 0xA9);
+
+    EXPECT_EQ(CountingMemory::copies, 0);
+}
+
+// Bank mapper test
+TEST(AF6502Tests, BankMapperTest)
+{
+    // Create CPU
+    CPU cpu(0);
+
+    // 4 banks of 16 KiB at $8000, each starting with its own number
+    auto mapper = std::make_shared<BankMapper>(0x8000, 0x4000, 4, false);
+    for (byte bank = 0; bank < 4; bank++)
+    {
+        std::vector<byte> tag = { bank };
+        mapper->Load(tag, bank * 0x4000);
+    }
+    EXPECT_EQ(mapper->Banks(), 4);
+    cpu.memory.Attach(mapper, 0xDF00, 0xDF00);
+    mapper->Select(cpu.memory, 0);
+
+    // Read bank 0, switch to bank 2 through the control register, read again
+    std::vector<byte> program = {
+        0xAD, 0x00, 0x80,   // LDA $8000
+        0x85, 0x10,         // STA $10
+        0xA9, 0x02,         // LDA #$02
+        0x8D, 0x00, 0xDF,   // STA $DF00
+        0xAD, 0x00, 0x80,   // LDA $8000
+        0x85, 0x11,         // STA $11
+        0x8D, 0x00, 0x80,   // STA $8000 (ROM, ignored)
+        0xAD, 0x00, 0xDF,   // LDA $DF00
+        0x02                // JAM
+    };
+    cpu.memory.WriteProgram(program, 0x0200);
+    cpu.PC = 0x0200;
+    cpu.run_for_cycles(100);
+    EXPECT_EQ(cpu.memory[0x0010], 0x00);
+    EXPECT_EQ(cpu.memory[0x0011], 0x02);
+    EXPECT_EQ(cpu.memory[0x8000], 0x02);
+    EXPECT_EQ(cpu.A, 0x02);
+    EXPECT_EQ(mapper->Selected(), 2);
+
+    // Switching only remaps pages
+    EXPECT_EQ(cpu.memory.PrivatePages(), 2);
+    mapper->Select(cpu.memory, 7);
+    EXPECT_EQ(mapper->Selected(), 3);
+    EXPECT_EQ(cpu.memory[0x8000], 0x03);
+    EXPECT_EQ(cpu.memory.PrivatePages(), 2);
+
+    // Restoring the baseline brings back its bank, and the control register still works
+    cpu.memory.SetBaseline();
+    for (int i = 0; i < 10000; i++)
+    {
+        mapper->Select(cpu.memory, i);
+    }
+    EXPECT_EQ(cpu.memory.DirtyPages(), 0x4000 / Memory::PAGE_SIZE);  // Each window page listed once
+    EXPECT_EQ(cpu.memory[0x8000], 0x03);
+    mapper->Select(cpu.memory, 1);
+    cpu.memory.Restore();
+    EXPECT_EQ(cpu.memory.DirtyPages(), 0);
+    EXPECT_EQ(mapper->Selected(), 3);
+    EXPECT_EQ(cpu.memory[0x8000], 0x03);
+    cpu.memory.WriteByte(0xDF00, 0x02);
+    EXPECT_EQ(mapper->Selected(), 2);
+    EXPECT_EQ(cpu.memory[0x8000], 0x02);
+
+    // A mapper needs banks to switch between
+    EXPECT_THROW(BankMapper(0x8000, 0x4000, 0, false), std::invalid_argument);
+    EXPECT_THROW(BankMapper(0x8000, 0x0080, 4, false), std::invalid_argument);
+
+    // Device numbers run out rather than wrap onto another device
+    Memory crowded;
+    for (word i = 0; i < Memory::MAX_DEVICES; i++)
+    {
+        crowded.Attach(std::make_shared<BankMapper>(0x8000, 0x100, 1, false), 0xF000, 0xF000);
+    }
+    EXPECT_THROW(crowded.Attach(mapper, 0xF100, 0xF100), std::length_error);
+    EXPECT_EQ(crowded[0xF100], 0x00);
+}
+
+// Mirrored RAM test
+TEST(AF6502Tests, MirroredRamTest)
+{
+    // Create CPU
+    EmbeddedCPU cpu(0);
+    EXPECT_LT(sizeof(cpu), 8 * 1024 + 128);
+
+    // 8 KiB of RAM show up 8 times in the address space
+    cpu.memory.WriteByte(0x0010, 0x42);
+    EXPECT_EQ(cpu.memory[0x2010], 0x42);
+    EXPECT_EQ(cpu.memory[0xE010], 0x42);
+    cpu.memory.WriteByte(0xFFFF, 0x34);
+    cpu.memory.WriteByte(0x0000, 0x12);
+    EXPECT_EQ(cpu.memory[0x1FFF], 0x34);
+    EXPECT_EQ(cpu.memory.ReadWord(0xFFFF), 0x1234);
+
+    // Same program, same results as the default core
+    std::vector<byte> program = { 0xA9, 0x05, 0x69, 0x03, 0xAA, 0xE8, 0x8D, 0x00, 0x03, 0xA0, 0x07, 0xC8, 0x4C, 0x00, 0x02 };
+    CPU reference(0);
+    reference.memory.WriteProgram(program, 0x0200);
+    reference.PC = 0x0200;
+    reference.run_for_cycles(100);
+    cpu.memory.WriteProgram(program, 0xE200);
+    cpu.PC = 0x0200;
+    cpu.run_for_cycles(100);
+    EXPECT_EQ(cpu.A, reference.A);
+    EXPECT_EQ(cpu.X, reference.X);
+    EXPECT_EQ(cpu.Y, reference.Y);
+    EXPECT_EQ(cpu.PC, reference.PC);
+    EXPECT_EQ(cpu.memory[0x0300], reference.memory[0x0300]);
+    EXPECT_EQ(cpu.elapsed(), reference.elapsed());
+}
+
+// Console test
+TEST(AF6502Tests, ConsoleTest)
+{
+    // Create CPU
+    CPU cpu(0);
+    auto console = std::make_shared<Console>(nullptr);
+    console->SetInput("ok");
+    cpu.memory.Attach(console, 0xF000, 0xF000);
+
+    // Print "HI", then echo the input until it runs out
+    std::vector<byte> program = {
+        0xA9, 0x48,         // LDA #'H'
+        0x8D, 0x00, 0xF0,   // STA $F000
+        0xA9, 0x49,         // LDA #'I'
+        0x8D, 0x00, 0xF0,   // STA $F000
+        0xAD, 0x01, 0xF0,   // LDA $F001
+        0xF0, 0x08,         // BEQ +8
+        0xAD, 0x00, 0xF0,   // LDA $F000
+        0x8D, 0x00, 0xF0,   // STA $F000
+        0xD0, 0xF3,         // BNE -13
+        0x02                // JAM
+    };
+    cpu.memory.WriteProgram(program, 0x0200);
+    cpu.PC = 0x0200;
+    cpu.run_for_cycles(200);
+    EXPECT_EQ(console->Output(), "HIok");
+    EXPECT_EQ(cpu.memory[0xF000], 0x00);
+    EXPECT_EQ(cpu.memory[0xF001], 0x00);
+
+    // A host stream is only read when the guest asks for input, a line at a time
+    std::FILE* in = std::tmpfile();
+    std::fputs("ab\ncd\n", in);
+    std::rewind(in);
+    auto host = std::make_shared<Console>(nullptr);
+    host->ReadInput(in);
+    EXPECT_EQ(std::ftell(in), 0);
+    EXPECT_EQ(host->Read(Console::STATUS), 1);
+    EXPECT_EQ(std::ftell(in), 3);
+    std::string echoed;
+    while (host->Read(Console::STATUS))
+    {
+        echoed += (char)host->Read(Console::DATA);
+    }
+    EXPECT_EQ(echoed, "ab\ncd\n");
+    EXPECT_EQ(host->Read(Console::DATA), 0);
+    std::fclose(in);
+}
+
+// Timer test
+TEST(AF6502Tests, TimerTest)
+{
+    // Create CPU
+    CPU cpu(0);
+    auto timer = std::make_shared<Timer>(cpu);
+    cpu.memory.Attach(timer, 0xF100, 0xF100);
+    cpu.I = true;   // Interrupts stay masked here
+
+    // Program: start the timer with a period of 100 cycles, then idle
+    std::vector<byte> program = {
+        0xA9, 0x63,         // LDA #99
+        0x8D, 0x00, 0xF1,   // STA $F100
+        0xA9, 0x00,         // LDA #0
+        0x8D, 0x01, 0xF1,   // STA $F101
+        0xA9, 0x03,         // LDA #3
+        0x8D, 0x02, 0xF1,   // STA $F102 (starts at cycle 18)
+        0xEA,               // NOP
+        0x4C, 0x0F, 0x02    // JMP $020F
+    };
+    cpu.memory.WriteProgram(program, 0x0200);
+    cpu.PC = 0x0200;
+    cpu.run_for_cycles(16);
+    EXPECT_EQ(cpu.elapsed(), 18);
+    EXPECT_EQ(timer->Count(), 99);
+    EXPECT_FALSE(timer->Pending());
+
+    // The count follows the elapsed cycles exactly
+    cpu.run_for_cycles(40);
+    EXPECT_EQ(cpu.elapsed(), 58);
+    EXPECT_EQ(cpu.memory[0xF100], 99 - 40);
+    EXPECT_EQ(cpu.memory[0xF103], 0);
+    EXPECT_EQ(timer->NextUnderflow(), 118);
+
+    cpu.run_for_cycles(200);
+    EXPECT_EQ(cpu.elapsed(), 258);
+    EXPECT_EQ(cpu.memory[0xF100], 99 - 40);
+    EXPECT_TRUE(timer->Pending());
+    EXPECT_EQ(cpu.memory[0xF103], 1);     // Reading acknowledges
+    EXPECT_FALSE(timer->Pending());
+    EXPECT_EQ(cpu.memory[0xF103], 0);
+    EXPECT_EQ(timer->NextUnderflow(), 318);
+
+    // A copy of the core does not get the timer's events: they stay
+    // with the core the timer counts for
+    {
+        CPU copy = cpu;
+        EXPECT_TRUE(copy.event_sources.empty());
+        EXPECT_EQ(cpu.event_sources.size(), 1);
+    }
+
+    // A timer dropped by the memory leaves the core's event sources
+    timer.reset();
+    cpu.memory.init();
+    EXPECT_TRUE(cpu.event_sources.empty());
+    cpu.run_for_cycles(500);
+    EXPECT_GE(cpu.elapsed(), 758);
+}
+
+// Interrupt test
+TEST(AF6502Tests, InterruptTest)
+{
+    // Create CPU
+    CPU cpu(0);
+    auto timer = std::make_shared<Timer>(cpu);
+    cpu.memory.Attach(timer, 0xF100, 0xF100);
+
+    // Main program: start a 100-cycle timer with interrupts, then idle
+    std::vector<byte> program = {
+        0xA9, 0x63,         // LDA #99
+        0x8D, 0x00, 0xF1,   // STA $F100
+        0xA9, 0x00,         // LDA #0
+        0x8D, 0x01, 0xF1,   // STA $F101
+        0xA9, 0x03,         // LDA #3
+        0x8D, 0x02, 0xF1,   // STA $F102
+        0x58,               // CLI
+        0x4C, 0x10, 0x02    // JMP $0210
+    };
+    // IRQ handler: count, acknowledge, return
+    std::vector<byte> irq = {
+        0xE6, 0x10,         // INC $10
+        0xAD, 0x03, 0xF1,   // LDA $F103
+        0x40                // RTI
+    };
+    // NMI handler: count, return
+    std::vector<byte> nmi = {
+        0xE6, 0x11,         // INC $11
+        0x40                // RTI
+    };
+    std::vector<byte> vectors = { 0x00, 0x04, 0x00, 0x00, 0x00, 0x03 };     // NMI, reset, IRQ
+    cpu.memory.WriteProgram(program, 0x0200);
+    cpu.memory.WriteProgram(irq, 0x0300);
+    cpu.memory.WriteProgram(nmi, 0x0400);
+    cpu.memory.WriteProgram(vectors, 0xFFFA);
+    cpu.PC = 0x0200;
+
+    // One interrupt per period (underflows at 118, 218... 1018)
+    cpu.run_for_cycles(1050);
+    EXPECT_EQ(cpu.memory[0x0010], 10);
+    EXPECT_EQ(cpu.memory[0x0011], 0);
+    EXPECT_FALSE(cpu.I);
+    EXPECT_EQ(cpu.SP, 0x0000);
+
+    // The IRQ frame: PC of the interrupted instruction, status with B clear
+    EXPECT_TRUE(cpu.run_until(0x0300, 200));
+    EXPECT_EQ(cpu.memory[0x0100], 0x02);
+    EXPECT_EQ(cpu.memory[0x01FF], 0x10);
+    EXPECT_EQ(cpu.memory[0x01FE] & 0x30, 0x20);
+    EXPECT_TRUE(cpu.I);
+
+    // NMI gets through even with IRQ masked, once
+    cpu.TriggerNmi();
+    cpu.step();
+    EXPECT_EQ(cpu.PC, 0x0400);
+    cpu.run_for_instructions(2);
+    EXPECT_EQ(cpu.PC, 0x0300);
+    EXPECT_TRUE(cpu.I);
+    cpu.run_for_instructions(3);
+    EXPECT_EQ(cpu.memory[0x0011], 1);
+    EXPECT_EQ(cpu.PC, 0x0210);
+}
+
+// DMA test
+TEST(AF6502Tests, DmaTest)
+{
+    // Create CPU
+    CPU cpu(0);
+    auto dma = std::make_shared<DmaController>(cpu);
+    cpu.memory.Attach(dma, 0xF200, 0xF200);
+    for (word i = 0; i < 300; i++)
+    {
+        cpu.memory.WriteByte(0x1080 + i, (byte)i);
+    }
+
+    // Copy 300 bytes from $1080 to $2010, then fill 16 bytes at $3000
+    std::vector<byte> program = {
+        0xA9, 0x80, 0x8D, 0x00, 0xF2,   // source $1080
+        0xA9, 0x10, 0x8D, 0x01, 0xF2,
+        0xA9, 0x10, 0x8D, 0x02, 0xF2,   // destination $2010
+        0xA9, 0x20, 0x8D, 0x03, 0xF2,
+        0xA9, 0x2C, 0x8D, 0x04, 0xF2,   // length 300
+        0xA9, 0x01, 0x8D, 0x05, 0xF2,
+        0xA9, 0x00, 0x8D, 0x07, 0xF2,   // copy
+        0xA9, 0x00, 0x8D, 0x02, 0xF2,   // destination $3000
+        0xA9, 0x30, 0x8D, 0x03, 0xF2,
+        0xA9, 0x10, 0x8D, 0x04, 0xF2,   // length 16
+        0xA9, 0x00, 0x8D, 0x05, 0xF2,
+        0xA9, 0xAA, 0x8D, 0x06, 0xF2,   // value $AA
+        0xA9, 0x01, 0x8D, 0x07, 0xF2,   // fill
+        0x02                            // JAM
+    };
+    cpu.memory.WriteProgram(program, 0x0200);
+    cpu.PC = 0x0200;
+    cpu.run_until(0x0241, 10000);
+    for (word i = 0; i < 300; i++)
+    {
+        EXPECT_EQ(cpu.memory[0x2010 + i], (byte)i);
+    }
+    EXPECT_EQ(cpu.memory[0x2010 + 300], 0x00);
+    EXPECT_EQ(cpu.memory[0x3000], 0xAA);
+    EXPECT_EQ(cpu.memory[0x300F], 0xAA);
+    EXPECT_EQ(cpu.memory[0x3010], 0x00);
+
+    // 13 register writes at 6 cycles each, plus the stolen cycles
+    EXPECT_EQ(cpu.elapsed(), 13 * 6 + 300 * DmaController::COPY_CYCLES + 16 * DmaController::FILL_CYCLES);
+
+    // Overlapping copies behave like a forward byte loop
+    cpu.memory.WriteByte(0x4000, 0x11);
+    cpu.memory.WriteByte(0x4001, 0x22);
+    cpu.memory.Copy(0x4002, 0x4000, 300);
+    EXPECT_EQ(cpu.memory[0x4002], 0x11);
+    EXPECT_EQ(cpu.memory[0x4003], 0x22);
+    EXPECT_EQ(cpu.memory[0x412C], 0x11);
+    EXPECT_EQ(cpu.memory[0x412D], 0x22);
+
+    // A transfer over the controller's own registers is refused
+    cpu.memory.WriteByte(0xF202, 0xF8);     // destination $F1F8
+    cpu.memory.WriteByte(0xF203, 0xF1);
+    cpu.memory.WriteByte(0xF204, 0x10);     // length 16
+    cpu.memory.WriteByte(0xF205, 0x00);
+    cpu.memory.WriteByte(0xF206, DmaController::FILL);
+    sword before = cpu.cycles;
+    cpu.memory.WriteByte(0xF207, DmaController::FILL);
+    EXPECT_EQ(cpu.memory[0xF1F8], 0x00);
+    EXPECT_EQ(cpu.memory[0xF202], 0xF8);
+    EXPECT_EQ(cpu.cycles, before);
+
+    // A core that does not count cycles is not charged for transfers
+    FuzzCPU untimed(0);
+    auto untimed_dma = std::make_shared<DmaController>(untimed);
+    untimed.memory.Attach(untimed_dma, 0xF200, 0xF200);
+    untimed.memory.WriteByte(0xF203, 0x30);     // destination $3000
+    untimed.memory.WriteByte(0xF204, 0x10);     // length 16
+    untimed.memory.WriteByte(0xF206, 0x77);
+    before = untimed.cycles;
+    untimed.memory.WriteByte(0xF207, DmaController::FILL);
+    EXPECT_EQ(untimed.memory[0x300F], 0x77);
+    EXPECT_EQ(untimed.cycles, before);
+}
+
+// Loop idiom test
+TEST(AF6502Tests, LoopIdiomTest)
+{
+    // Copy $10F0.. to $2080.. from Y = $10, then fill $3000.. with $55
+    // from Y = 0, with the copy loop's branch crossing a page
+    std::vector<byte> program = {
+        0xA9, 0xF0, 0x85, 0x10,     // LDA #$F0, STA $10
+        0xA9, 0x10, 0x85, 0x11,     // LDA #$10, STA $11
+        0xA9, 0x80, 0x85, 0x12,     // LDA #$80, STA $12
+        0xA9, 0x20, 0x85, 0x13,     // LDA #$20, STA $13
+        0xA9, 0x00, 0x85, 0x14,     // LDA #$00, STA $14
+        0xA9, 0x30, 0x85, 0x15,     // LDA #$30, STA $15
+        0xA0, 0x10,                 // LDY #$10
+        0x4C, 0xFC, 0x02            // JMP $02FC
+    };
+    std::vector<byte> loops = {
+        0xB1, 0x10,         // $02FC: LDA ($10),Y
+        0x91, 0x12,         //        STA ($12),Y
+        0xC8,               //        INY
+        0xD0, 0xF9,         //        BNE $02FC
+        0xA9, 0x55,         //        LDA #$55
+        0x91, 0x14,         // $0305: STA ($14),Y
+        0xC8,               //        INY
+        0xD0, 0xFB,         //        BNE $0305
+        0x02                // $030A: JAM
+    };
+
+    // Create CPUs
+    CPU fused(0);
+    CPU stepped(0);
+    for (CPU* cpu: { &fused, &stepped })
+    {
+        cpu->memory.WriteProgram(program, 0x0200);
+        cpu->memory.WriteProgram(loops, 0x02FC);
+        for (word i = 0; i < 0x200; i++)
+        {
+            cpu->memory.WriteByte(0x10F0 + i, (byte)(i * 7));
+        }
+        cpu->PC = 0x0200;
+        cpu->V = true;
+        cpu->C = true;
+    }
+
+    // Cycle-bounded runs take the native path, single steps never do
+    // Copy: 240 iterations of 15 cycles, plus 240 page crossings on the
+    // loads and 239 taken branches crossing a page
+    fused.run_until(0x02FC, 1000);
+    fused.run_for_cycles(240 * 15 + 240 + 239 * 2);
+    EXPECT_EQ(fused.PC, 0x0303);
+    EXPECT_EQ(fused.fused_loops, 1);
+    // LDA #$55, then fill: 256 iterations of 10 cycles and 255 taken
+    // branches within the page
+    fused.run_for_cycles(2 + 256 * 10 + 255);
+    EXPECT_EQ(fused.PC, 0x030A);
+    EXPECT_EQ(fused.fused_loops, 2);
+    while (stepped.PC != 0x030A)
+    {
+        stepped.step();
+    }
+
+    EXPECT_EQ(fused.A, stepped.A);
+    EXPECT_EQ(fused.X, stepped.X);
+    EXPECT_EQ(fused.Y, stepped.Y);
+    EXPECT_EQ(fused.Status(), stepped.Status());
+    EXPECT_EQ(fused.SP, stepped.SP);
+    EXPECT_EQ(fused.elapsed(), stepped.elapsed());
+    for (word address = 0; address < 0x10000; address++)
+    {
+        ASSERT_EQ(fused.memory[address], stepped.memory[address]) << address;
+    }
+    EXPECT_EQ(fused.memory[0x2090], (byte)(0x10 * 7));
+    EXPECT_EQ(fused.memory[0x3000], 0x55);
+    EXPECT_EQ(fused.memory[0x30FF], 0x55);
+
+    // A loop that writes over its own pointer is only fused once it is
+    // past it, with the same result
+    CPU guarded(0);
+    CPU reference(0);
+    std::vector<byte> clear = {
+        0xA9, 0x07, 0xA0, 0x00,     // LDA #7, LDY #0 (pointer at $0000)
+        0x91, 0x00,                 // STA ($00),Y
+        0xC8,                       // INY
+        0xD0, 0xFB,                 // BNE
+        0x02                        // JAM
+    };
+    for (CPU* cpu: { &guarded, &reference })
+    {
+        cpu->memory.WriteProgram(clear, 0x0200);
+        cpu->PC = 0x0200;
+    }
+    guarded.run_for_cycles(10000);
+    while (reference.PC != 0x0209)
+    {
+        reference.step();
+    }
+    EXPECT_EQ(guarded.fused_loops, 1);
+    EXPECT_EQ(guarded.Y, reference.Y);
+    EXPECT_EQ(guarded.Status(), reference.Status());
+    for (word address = 0; address < 0x0400; address++)
+    {
+        ASSERT_EQ(guarded.memory[address], reference.memory[address]) << address;
+    }
+    EXPECT_EQ(stepped.fused_loops, 0);
+
+    // On mirrored RAM, a destination that aliases the pointers is caught too:
+    // $2000 is $0000 in 8 KiB
+    EmbeddedCPU mirrored(0);
+    EmbeddedCPU interpreted(0);
+    std::vector<byte> aliasing = {
+        0xA9, 0x00, 0x85, 0x10,     // LDA #$00, STA $10
+        0xA9, 0x03, 0x85, 0x11,     // LDA #$03, STA $11
+        0xA9, 0x00, 0x85, 0x12,     // LDA #$00, STA $12
+        0xA9, 0x20, 0x85, 0x13,     // LDA #$20, STA $13
+        0xA0, 0x00,                 // LDY #0
+        0xB1, 0x10,                 // $0212: LDA ($10),Y
+        0x91, 0x12,                 //        STA ($12),Y
+        0xC8,                       //        INY
+        0xD0, 0xF9,                 //        BNE $0212
+        0x02                        // $0219: JAM
+    };
+    for (EmbeddedCPU* cpu: { &mirrored, &interpreted })
+    {
+        cpu->memory.WriteProgram(aliasing, 0x0200);
+        for (word i = 0; i < 0x100; i++)
+        {
+            cpu->memory.WriteByte(0x0300 + i, (byte)(i * 3 + 1));
+        }
+        cpu->PC = 0x0200;
+    }
+    mirrored.run_for_cycles(20000);
+    while (interpreted.PC != 0x0219)
+    {
+        interpreted.step();
+    }
+    EXPECT_EQ(mirrored.PC, 0x0219);
+    EXPECT_EQ(mirrored.A, interpreted.A);
+    EXPECT_EQ(mirrored.Y, interpreted.Y);
+    EXPECT_EQ(mirrored.Status(), interpreted.Status());
+    EXPECT_EQ(mirrored.memory.ReadWord(0x12), interpreted.memory.ReadWord(0x12));
+    for (word address = 0; address < 0x2000; address++)
+    {
+        ASSERT_EQ(mirrored.memory[address], interpreted.memory[address]) << address;
+    }
+}
+
+// Native hook test
+TEST(AF6502Tests, HookTest)
+{
+    // Create CPUs
+    CPU native(0);
+    CPU guest(0);
+    std::vector<byte> multiply = {
+        0xA9, 0x00,     // LDA #0
+        0xA6, 0x11,     // LDX $11
+        0xF0, 0x06,     // BEQ done
+        0x18,           // loop: CLC
+        0x65, 0x10,     // ADC $10
+        0xCA,           // DEX
+        0xD0, 0xFA,     // BNE loop
+        0x60            // done: RTS
+    };
+    std::vector<byte> program = {
+        0x20, 0x00, 0x10,   // JSR $1000
+        0x85, 0x20,         // STA $20
+        0x02                // JAM
+    };
+    for (CPU* cpu: { &native, &guest })
+    {
+        cpu->memory.WriteProgram(multiply, 0x1000);
+        cpu->memory.WriteProgram(program, 0x0200);
+        cpu->memory.WriteByte(0x10, 3);
+        cpu->memory.WriteByte(0x11, 5);
+        cpu->PC = 0x0200;
+    }
+
+    // Same result and the same cycles as the guest routine
+    int calls = 0;
+    native.AddHook(0x1000, [&calls](CPU& cpu) -> word {
+        calls++;
+        byte times = cpu.memory[0x11];
+        cpu.A = cpu.memory[0x10] * times;
+        cpu.X = 0;
+        cpu.C = 0;
+        cpu.SetZN(cpu.X);
+        return 62;  // What the guest routine takes for 3 * 5, RTS included
+    });
+    native.run_until(0x0205, 1000);
+    guest.run_until(0x0205, 1000);
+    EXPECT_EQ(calls, 1);
+    EXPECT_EQ(native.memory[0x20], 15);
+    EXPECT_EQ(native.memory[0x20], guest.memory[0x20]);
+    EXPECT_EQ(native.elapsed(), guest.elapsed());
+    EXPECT_EQ(native.SP, guest.SP);
+    EXPECT_EQ(native.Status(), guest.Status());
+
+    // Another address on the same page does not match, and a removed hook
+    // goes back to the guest routine
+    CPU other(0);
+    other.memory.WriteProgram(multiply, 0x1000);
+    other.memory.WriteProgram(program, 0x0200);
+    other.memory.WriteByte(0x10, 3);
+    other.memory.WriteByte(0x11, 5);
+    other.AddHook(0x1080, [&calls](CPU&) -> word { calls++; return 0; });
+    other.AddHook(0x1000, [&calls](CPU&) -> word { calls++; return 0; });
+    other.RemoveHook(0x1000);
+    EXPECT_TRUE(other.hooks->pages[0x10]);
+    other.RemoveHook(0x1080);
+    EXPECT_FALSE(other.hooks->pages[0x10]);
+    other.PC = 0x0200;
+    other.run_until(0x0205, 1000);
+    EXPECT_EQ(calls, 1);
+    EXPECT_EQ(other.memory[0x20], 15);
+    EXPECT_EQ(other.elapsed(), guest.elapsed());
+}
+
+// Hypercall test
+TEST(AF6502Tests, HypercallTest)
+{
+    // Create CPU
+    CPU cpu(0);
+    std::string printed;
+    cpu.SetHypercall(0x02, [&printed](CPU& cpu) -> word {
+        switch (cpu.A)
+        {
+            case 0: // Print the character in X
+                printed += (char)cpu.X;
+                return 0;
+            case 1: // Load a file into the page in Y, length in A
+            {
+                std::vector<byte> file = { 'h', 'o', 's', 't' };
+                cpu.memory.WriteProgram(file, (hword)cpu.Y << 8);
+                cpu.A = (byte)file.size();
+                return 10;
+            }
+            default:
+                return 0;
+        }
+    });
+    std::vector<byte> program = {
+        0xA9, 0x00, 0xA2, 0x48, 0x02,   // LDA #0, LDX #'H', HYP
+        0xA2, 0x69, 0x02,               // LDX #'i', HYP
+        0xA9, 0x01, 0xA0, 0x30, 0x02,   // LDA #1, LDY #$30, HYP
+        0x85, 0x20,                     // STA $20
+        0x12                            // JAM (not the hypercall)
+    };
+    cpu.memory.WriteProgram(program, 0x0200);
+    cpu.PC = 0x0200;
+    cpu.run_until(0x020F, 1000);
+    EXPECT_EQ(cpu.elapsed(), 2 + 2 + 1 + 2 + 1 + 2 + 2 + 11 + 3);
+    cpu.run_for_cycles(100);
+    EXPECT_EQ(printed, "Hi");
+    EXPECT_EQ(cpu.memory[0x3000], 'h');
+    EXPECT_EQ(cpu.memory[0x3003], 't');
+    EXPECT_EQ(cpu.memory[0x20], 4);
+    EXPECT_EQ(cpu.PC, 0x020F);  // Stuck on the other JAM
+
+    // Undefined opcodes can trap too, and turning the service off stops the CPU again
+    DocumentedCPU documented(0);
+    int calls = 0;
+    documented.SetHypercall(0x03, [&calls](DocumentedCPU&) -> word { calls++; return 0; });
+    std::vector<byte> undefined = { 0x03, 0x03, 0xEA };
+    documented.memory.WriteProgram(undefined, 0x0200);
+    documented.PC = 0x0200;
+    documented.run_for_instructions(3);
+    EXPECT_EQ(calls, 2);
+    EXPECT_EQ(documented.PC, 0x0203);
+    documented.SetHypercall(0x03, {});
+    documented.PC = 0x0200;
+    documented.run_for_instructions(1);
+    EXPECT_EQ(calls, 2);
+
+    // Opcodes that run an instruction cannot trap: LDA #, and SLO zp on a
+    // core that implements the illegal opcodes
+    auto service = [](CPU&) -> word { return 0; };
+    EXPECT_THROW(cpu.SetHypercall(0xA9, service), std::invalid_argument);
+    EXPECT_THROW(cpu.SetHypercall(0x07, service), std::invalid_argument);
+    EXPECT_NO_THROW(documented.SetHypercall(0x07, {}));
+}
+
+// Program translated by the recompiler into recompiled_sample.inc, at $0200.
+// The translation is checked in to be compiled with the tests, which run it
+// against the interpreter; regenerating it after a codegen change is optional
+static const std::vector<byte> recompiler_sample = {
+    0xA9, 0x63, 0x8D, 0x00, 0xF1,   // LDA #99, STA $F100
+    0xA9, 0x00, 0x8D, 0x01, 0xF1,   // LDA #0, STA $F101
+    0xA9, 0x03, 0x8D, 0x02, 0xF1,   // LDA #3, STA $F102 (timer IRQ every 100 cycles)
+    0x58,                           // CLI
+    0xA2, 0x00,                     // $0210: LDX #0
+    0x8A,                           // $0212: TXA
+    0x20, 0x40, 0x02,               // JSR $0240
+    0x9D, 0x00, 0x30,               // STA $3000,X
+    0xE8, 0xE0, 0x40,               // INX, CPX #$40
+    0xD0, 0xF4,                     // BNE $0212
+    0xA9, 0x50, 0x85, 0x10,         // LDA #$50, STA $10
+    0xA9, 0x02, 0x85, 0x11,         // LDA #$02, STA $11
+    0x6C, 0x10, 0x00,               // JMP ($0010): $0250 is not translated
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // Data
+    0x0A, 0x18, 0x69, 0x03, 0x60,   // $0240: ASL A, CLC, ADC #3, RTS
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xA0, 0x05, 0x88, 0xD0, 0xFD,   // $0250: LDY #5, DEY, BNE $0252
+    0x4C, 0x10, 0x02,               // JMP $0210
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xE6, 0x20, 0xAD, 0x03, 0xF1,   // $0260: INC $20, LDA $F103 (IRQ handler)
+    0x40                            // RTI
+};
+
+#include "recompiled_sample.inc"
+
+// Recompiler test
+TEST(AF6502Tests, RecompilerTest)
+{
+    // One case per instruction found; calls and branches go straight to
+    // the translated destination, anything else back to the switch
+    std::string source = Recompile(recompiler_sample, 0x0200, 0x0200, "recompiled_sample");
+    auto has = [&source](const char* text) { return source.find(text) != std::string::npos; };
+    EXPECT_TRUE(has("23 instructions reached from $0200"));
+    EXPECT_TRUE(has("bool recompiled_sample(CPU& cpu)"));
+    EXPECT_TRUE(has("case 0x0216:    // STA"));
+    EXPECT_TRUE(has("cpu.Execute<Operation::STA, AddrMode::AbsoluteX>();"));
+    EXPECT_TRUE(has("if (cpu.PC == 0x0240) goto at_0240;"));    // JSR
+    EXPECT_TRUE(has("if (cpu.PC == 0x0212) goto at_0212;"));    // BNE taken
+    EXPECT_TRUE(has("return !first;"));
+    EXPECT_FALSE(has("case 0x0229:"));  // Data
+    EXPECT_FALSE(has("case 0x0250:"));  // Through JMP ($0010) only
+
+    // Only the code reached from the entry point is found
+    std::vector<Decoded> code = FindCode(recompiler_sample, 0x0200, 0x0200);
+    EXPECT_EQ(code.size(), 23);
+    EXPECT_EQ(code.front().address, 0x0200);
+    EXPECT_EQ(code.back().address, 0x0244);
+
+    // A copy loop's body is one block: the translation checks PC after the
+    // loads and stores that may run the loop natively
+    std::vector<byte> copy = {
+        0xA0, 0x00,         // $0300: LDY #0
+        0xB1, 0x10,         // $0302: LDA ($10),Y
+        0x91, 0x12,         // STA ($12),Y
+        0xC8,               // INY
+        0xD0, 0xF9,         // BNE $0302
+        0x60                // RTS
+    };
+    code = FindCode(copy, 0x0300, 0x0300);
+    ASSERT_EQ(code.size(), 6);
+    EXPECT_FALSE(code[1].transfers);
+    EXPECT_FALSE(code[2].transfers);
+    EXPECT_EQ(FindBlocks(code).size(), 3);
+    std::string copier = Recompile(copy, 0x0300, 0x0300, "copier");
+    EXPECT_NE(copier.find("cpu.pending || cpu.PC != 0x0304) return true;"), std::string::npos);
+    EXPECT_NE(copier.find("cpu.pending || cpu.PC != 0x0306) return true;"), std::string::npos);
+
+    // Create CPUs: one interpreted, one translated, each with a timer
+    CPU interpreted(0);
+    CPU translated(0);
+    std::vector<std::shared_ptr<Timer>> timers;
+    std::vector<byte> vector = { 0x60, 0x02 };
+    for (CPU* cpu: { &interpreted, &translated })
+    {
+        timers.push_back(std::make_shared<Timer>(*cpu));
+        cpu->memory.Attach(timers.back(), 0xF100, 0xF100);
+        cpu->memory.WriteProgram(recompiler_sample, 0x0200);
+        cpu->memory.WriteProgram(vector, 0xFFFE);
+        cpu->PC = 0x0200;
+    }
+    for (int slice = 0; slice < 200; slice++)
+    {
+        interpreted.run_for_cycles(97);
+        translated.run_translated(recompiled_sample, 97);
+        ASSERT_EQ(translated.elapsed(), interpreted.elapsed()) << slice;
+        ASSERT_EQ(translated.PC, interpreted.PC) << slice;
+        ASSERT_EQ(translated.A, interpreted.A) << slice;
+        ASSERT_EQ(translated.X, interpreted.X) << slice;
+        ASSERT_EQ(translated.Y, interpreted.Y) << slice;
+        ASSERT_EQ(translated.SP, interpreted.SP) << slice;
+        ASSERT_EQ(translated.Status(), interpreted.Status()) << slice;
+    }
+    for (word address = 0; address < 0x4000; address++)
+    {
+        ASSERT_EQ(translated.memory[address], interpreted.memory[address]) << address;
+    }
+    EXPECT_GT(translated.memory[0x20], 100);    // Interrupts were taken
+    EXPECT_EQ(translated.memory[0x303F], (byte)(0x3F * 2 + 3));
+}
+
+// Decode cache test
+TEST(AF6502Tests, DecodeCacheTest)
+{
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "af6502_decode_cache_test";
+    std::filesystem::remove_all(directory);
+
+    // A cold cache decodes and stores, a warm one reads back the same code
+    DecodeCache cold(directory);
+    std::vector<Decoded> decoded = cold.FindCode(recompiler_sample, 0x0200, 0x0200);
+    EXPECT_EQ(cold.stats.misses, 1);
+    EXPECT_EQ(cold.stats.hits, 0);
+    DecodeCache warm(directory);
+    std::vector<Decoded> cached = warm.FindCode(recompiler_sample, 0x0200, 0x0200);
+    EXPECT_EQ(warm.stats.hits, 1);
+    EXPECT_EQ(warm.stats.misses, 0);
+    ASSERT_EQ(cached.size(), decoded.size());
+    for (std::size_t i = 0; i < cached.size(); i++)
+    {
+        EXPECT_EQ(cached[i].address, decoded[i].address);
+        EXPECT_EQ(cached[i].opcode, decoded[i].opcode);
+        EXPECT_EQ(cached[i].transfers, decoded[i].transfers);
+        EXPECT_EQ(cached[i].target, decoded[i].target);
+    }
+    EXPECT_EQ(Recompile(cached, 0x0200, "recompiled_sample"),
+        Recompile(recompiler_sample, 0x0200, 0x0200, "recompiled_sample"));
+
+    // The second run reports reading the first run's file
+    std::FILE* out = std::tmpfile();
+    warm.Report(out);
+    std::rewind(out);
+    char report[80] = {};
+    std::fgets(report, sizeof(report), out);
+    std::fclose(out);
+    EXPECT_STREQ(report, "Decode cache: 1 hits, 0 misses (0 rejected)\n");
+
+    // Another load address or another image is another entry
+    warm.FindCode(recompiler_sample, 0x0300, 0x0300);
+    std::vector<byte> changed = recompiler_sample;
+    changed[1] = 0x64;
+    warm.FindCode(changed, 0x0200, 0x0200);
+    EXPECT_EQ(warm.stats.misses, 2);
+    EXPECT_NE(DecodeCache::Key(changed, 0x0200, 0x0200), DecodeCache::Key(recompiler_sample, 0x0200, 0x0200));
+
+    // A file that does not match its image is rejected and replaced
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.decode",
+        (unsigned long long)DecodeCache::Key(recompiler_sample, 0x0200, 0x0200));
+    {
+        std::fstream file(directory / name, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(34 + 2 + 2);   // Opcode of the first record, after the header and the entry point
+        file.put((char)0xEA);
+    }
+    DecodeCache checked(directory);
+    EXPECT_EQ(checked.FindCode(recompiler_sample, 0x0200, 0x0200).size(), decoded.size());
+    EXPECT_EQ(checked.stats.rejected, 1);
+    EXPECT_EQ(checked.stats.misses, 1);
+    checked.FindCode(recompiler_sample, 0x0200, 0x0200);
+    EXPECT_EQ(checked.stats.hits, 1);
+
+    // So is a file written by another version of the decoder
+    {
+        std::fstream file(directory / name, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(8);  // Version, after the magic
+        file.put((char)2);
+    }
+    DecodeCache older(directory);
+    older.FindCode(recompiler_sample, 0x0200, 0x0200);
+    EXPECT_EQ(older.stats.rejected, 1);
+    EXPECT_EQ(older.stats.hits, 0);
+
+    std::filesystem::remove_all(directory);
+}
+
+// Profile of the recompiler sample over 20000 cycles
+static Profile ProfileSample()
+{
+    ProfileCPU cpu(0);
+    auto timer = std::make_shared<Timer>(cpu);
+    std::vector<byte> vector = { 0x60, 0x02 };
+    cpu.memory.Attach(timer, 0xF100, 0xF100);
+    cpu.memory.WriteProgram(recompiler_sample, 0x0200);
+    cpu.memory.WriteProgram(vector, 0xFFFE);
+    cpu.PC = 0x0200;
+    cpu.run_for_cycles(20000);
+    return *cpu.trace.profile;
+}
+
+#include "recompiled_profiled.inc"
+
+// Profile test
+TEST(AF6502Tests, ProfileTest)
+{
+    // Entries are counted wherever control does not fall through, branches both ways
+    Profile profile = ProfileSample();
+    EXPECT_EQ(profile.entries[0x0200], 1);
+    EXPECT_EQ(profile.entries[0x0201], 0);
+    EXPECT_GT(profile.entries[0x0212], profile.entries[0x0210]);
+    EXPECT_GT(profile.entries[0x0250], 0);  // Only reached through JMP ($0010)
+    EXPECT_GT(profile.entries[0x0260], 0);  // IRQ handler
+    EXPECT_TRUE(profile.Taken(0x021C));
+    EXPECT_GT(profile.taken[0x021C], 60 * profile.not_taken[0x021C]);  // 63 to 1, less interrupted ones
+    std::vector<hword> hot = profile.HotEntries();
+    ASSERT_GE(hot.size(), 2);
+    std::sort(hot.begin(), hot.begin() + 2);
+    EXPECT_EQ(hot[0], 0x0216);  // Returned to on every pass of the loop (and by interrupts)
+    EXPECT_EQ(hot[1], 0x0240);  // Called on every pass of the loop
+
+    // Saved and loaded back, it is the same profile
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "af6502_profile_test.txt";
+    ASSERT_TRUE(profile.Save(path));
+    Profile loaded;
+    ASSERT_TRUE(loaded.Load(path));
+    EXPECT_EQ(loaded.entries, profile.entries);
+    EXPECT_EQ(loaded.taken, profile.taken);
+    EXPECT_EQ(loaded.not_taken, profile.not_taken);
+    std::filesystem::remove(path);
+
+    // The profiled entries bring in code the traversal misses, hottest first
+    std::vector<hword> entries = { 0x0200 };
+    for (hword entry: profile.HotEntries())
+    {
+        entries.push_back(entry);
+    }
+    std::vector<Decoded> code = FindCode(recompiler_sample, 0x0200, entries);
+    EXPECT_EQ(code.size(), 23 + 4 + 3);
+    std::string source = Recompile(code, 0x0200, "recompiled_profiled", &profile);
+    EXPECT_NE(source.find("laid out by a profile"), std::string::npos);
+
+    // The hottest block comes first, each block is followed by the one it
+    // mostly leads to, and the run-once start-up code comes last
+    auto at = [&source](const char* text) { return source.find(text); };
+    auto next_case = [&source](const char* text) { return source.substr(source.find("case 0x", source.find(text) + 1), 12); };
+    EXPECT_EQ(next_case("switch (cpu.PC)"), "case 0x0216:");
+    EXPECT_EQ(next_case("case 0x021C:"), "case 0x0212:");  // BNE, mostly taken
+    EXPECT_EQ(next_case("case 0x0213:"), "case 0x0240:");  // JSR
+    EXPECT_LT(at("case 0x0240:"), at("case 0x0200:"));
+    EXPECT_LT(at("case 0x0226:"), at("case 0x0200:"));
+    EXPECT_NE(at("case 0x0260:"), std::string::npos);  // IRQ handler, from the profile
+    EXPECT_NE(at("goto at_0212;"), std::string::npos);  // LDX, laid out away from the loop
+
+    // And it runs like the interpreter
+    CPU interpreted(0);
+    CPU translated(0);
+    std::vector<std::shared_ptr<Timer>> timers;
+    std::vector<byte> vector = { 0x60, 0x02 };
+    for (CPU* cpu: { &interpreted, &translated })
+    {
+        timers.push_back(std::make_shared<Timer>(*cpu));
+        cpu->memory.Attach(timers.back(), 0xF100, 0xF100);
+        cpu->memory.WriteProgram(recompiler_sample, 0x0200);
+        cpu->memory.WriteProgram(vector, 0xFFFE);
+        cpu->PC = 0x0200;
+    }
+    for (int slice = 0; slice < 200; slice++)
+    {
+        interpreted.run_for_cycles(89);
+        translated.run_translated(recompiled_profiled, 89);
+        ASSERT_EQ(translated.elapsed(), interpreted.elapsed()) << slice;
+        ASSERT_EQ(translated.PC, interpreted.PC) << slice;
+        ASSERT_EQ(translated.A, interpreted.A) << slice;
+        ASSERT_EQ(translated.X, interpreted.X) << slice;
+        ASSERT_EQ(translated.Y, interpreted.Y) << slice;
+        ASSERT_EQ(translated.SP, interpreted.SP) << slice;
+        ASSERT_EQ(translated.Status(), interpreted.Status()) << slice;
+    }
+    for (word address = 0; address < 0x4000; address++)
+    {
+        ASSERT_EQ(translated.memory[address], interpreted.memory[address]) << address;
+    }
+}
+
+// Code map test
+TEST(AF6502Tests, CodeMapTest)
+{
+    // The sample, loaded at $0200, with its IRQ vector at the end of memory
+    std::vector<byte> image(MEM_SIZE - 0x0200);
+    std::copy(recompiler_sample.begin(), recompiler_sample.end(), image.begin());
+    image[0xFFFE - 0x0200] = 0x60;
+    image[0xFFFF - 0x0200] = 0x02;
+    CodeMap map = MapCode(image, 0x0200, 0x0200);
+
+    // Opcodes and operands are code, data and unreached code are not
+    EXPECT_TRUE(map.IsCode(0x0200));
+    EXPECT_TRUE(map.IsCode(0x0201));
+    EXPECT_TRUE(map.IsCode(0x0228));
+    EXPECT_FALSE(map.IsCode(0x0229));
+    EXPECT_FALSE(map.IsCode(0x023F));
+    EXPECT_TRUE(map.IsCode(0x0260));    // Through the IRQ vector
+    EXPECT_EQ(map.entries.front(), 0x0200);
+    EXPECT_EQ(map.entries.back(), 0x0260);
+    EXPECT_FALSE(map.IsCode(0x0250));   // Through JMP ($0010) only
+    EXPECT_TRUE(map.pages[0x02]);
+    EXPECT_FALSE(map.pages[0x03]);
+
+    // Blocks start at destinations and after transfers
+    std::vector<hword> firsts;
+    for (const BasicBlock& block: map.blocks)
+    {
+        firsts.push_back(block.first);
+    }
+    EXPECT_EQ(firsts, (std::vector<hword>{ 0x0200, 0x0212, 0x0216, 0x021E, 0x0240, 0x0260 }));
+    EXPECT_EQ(map.blocks[1].last, 0x0213);
+    EXPECT_EQ(map.blocks[1].successors, (std::vector<hword>{ 0x0240, 0x0216 }));    // Call and return
+    EXPECT_EQ(map.blocks[2].successors, (std::vector<hword>{ 0x0212, 0x021E }));
+    EXPECT_TRUE(map.blocks[3].successors.empty());  // JMP ($0010)
+    EXPECT_TRUE(map.blocks[5].successors.empty());  // RTI
+
+    // Data ranges are listed after the blocks
+    std::FILE* out = std::tmpfile();
+    map.Print(out, 0x0200, recompiler_sample.size());
+    std::rewind(out);
+    std::string printed;
+    for (int c; (c = std::fgetc(out)) != EOF; )
+    {
+        printed += (char)c;
+    }
+    std::fclose(out);
+    EXPECT_NE(printed.find("code $0212-$0213 (2) $0240 $0216\n"), std::string::npos);
+    EXPECT_NE(printed.find("data $0229-$023F\n"), std::string::npos);
+    EXPECT_NE(printed.find("data $0245-$025F\n"), std::string::npos);
+
+    // Writes into code pages since the baseline are flagged
+    Memory memory;
+    memory.WriteProgram(recompiler_sample, 0x0200);
+    memory.SetBaseline();
+    memory.WriteByte(0x3000, 1);
+    EXPECT_TRUE(map.WrittenPages(memory).empty());
+    memory.WriteByte(0x0230, 1);
+    EXPECT_EQ(map.WrittenPages(memory), (std::vector<byte>{ 0x02 }));
+}
+
+// Cycle estimator test
+TEST(AF6502Tests, EstimatorTest)
+{
+    // The sample: the subroutine and the IRQ handler return, the main
+    // program leaves through JMP ($0010)
+    std::vector<byte> image(MEM_SIZE - 0x0200);
+    std::copy(recompiler_sample.begin(), recompiler_sample.end(), image.begin());
+    image[0xFFFE - 0x0200] = 0x60;
+    image[0xFFFF - 0x0200] = 0x02;
+    CodeMap map = MapCode(image, 0x0200, 0x0200);
+    std::vector<hword> entries = { 0x0200, 0x0260 };
+    CycleEstimate estimate = EstimateCycles(image, 0x0200, map, {}, entries);
+    EXPECT_EQ(estimate.routines.at(0x0240), 12);    // ASL, CLC, ADC, RTS
+    EXPECT_EQ(estimate.routines.at(0x0260), 15);    // INC, LDA, RTI
+    EXPECT_EQ(estimate.routines.at(0x0200), UNBOUNDED);
+    EXPECT_EQ(estimate.blocks[2], 12);  // STA $3000,X, INX, CPX, BNE taken
+
+    // A bounded loop: one indexed load stays in its page, the other may not
+    std::vector<byte> loop = {
+        0xA2, 0x03,         // $0300: LDX #3
+        0xBD, 0x00, 0x40,   // $0302: LDA $4000,X
+        0xBD, 0x01, 0x40,   // LDA $4001,X
+        0xCA,               // DEX
+        0xD0, 0xF7,         // BNE $0302
+        0x60                // RTS
+    };
+    map = MapCode(loop, 0x0300, 0x0300);
+    entries = { 0x0300 };
+    EXPECT_EQ(EstimateCycles(loop, 0x0300, map, {}, entries).routines.at(0x0300), UNBOUNDED);
+    estimate = EstimateCycles(loop, 0x0300, map, { { 0x0302, 3 } }, entries);
+    EXPECT_EQ(estimate.routines.at(0x0300), 2 + 2 * 14 + 13 + 6);
+
+    // The estimate bounds a real run of the routine
+    CPU cpu(0);
+    cpu.memory.WriteProgram(loop, 0x0300);
+    cpu.PC = 0x0300;
+    cpu.run_until(0x030B, 1000);
+    EXPECT_LE(cpu.elapsed() + 6, estimate.routines.at(0x0300));
+
+    // The estimator and the interpreter share the opcode table's timing:
+    // shifts, increments and BIT on memory, indexed stores and read-modify-
+    // writes, and branches taken within and across a page
+    struct Routine
+    {
+        hword entry;
+        LoopBounds bounds;
+        std::vector<byte> code;
+    };
+    std::vector<Routine> routines = {
+        { 0x0400, {}, {
+            0x06, 0x10,         // ASL $10
+            0x46, 0x11,         // LSR $11
+            0xE6, 0x12,         // INC $12
+            0xC6, 0x13,         // DEC $13
+            0x24, 0x14,         // BIT $14
+            0x2C, 0x00, 0x30,   // BIT $3000
+            0xA2, 0x05,         // LDX #5
+            0xA0, 0x07,         // LDY #7
+            0x9D, 0x00, 0x30,   // STA $3000,X
+            0x99, 0x00, 0x30,   // STA $3000,Y
+            0x3E, 0x00, 0x30,   // ROL $3000,X
+            0x7E, 0x00, 0x30,   // ROR $3000,X
+            0x4A,               // LSR A
+            0x0A,               // ASL A
+            0x18,               // CLC
+            0x90, 0x00,         // BCC, taken
+            0x60                // RTS
+        } },
+        { 0x0500, { { 0x0502, 4 } }, {
+            0xA2, 0x04,         // LDX #4
+            0x16, 0x10,         // $0502: ASL $10,X
+            0x5E, 0x00, 0x30,   // LSR $3000,X
+            0xFE, 0x00, 0x30,   // INC $3000,X
+            0xC6, 0x20,         // DEC $20
+            0x99, 0x00, 0x31,   // STA $3100,Y
+            0x7E, 0x00, 0x30,   // ROR $3000,X
+            0xCA,               // DEX
+            0xD0, 0xED,         // BNE $0502
+            0x60                // RTS
+        } },
+        { 0x05F0, { { 0x05F2, 3 } }, {
+            0xA0, 0x03,         // LDY #3
+            0x2C, 0x00, 0x30,   // $05F2: BIT $3000
+            0x99, 0x00, 0x30,   // STA $3000,Y
+            0x26, 0x10,         // ROL $10
+            0x46, 0x11,         // LSR $11
+            0xE6, 0x12,         // INC $12
+            0xC6, 0x13,         // DEC $13
+            0x88,               // $0600: DEY
+            0xD0, 0xEF,         // BNE $05F2, across the page
+            0x60                // RTS
+        } }
+    };
+    for (const Routine& routine: routines)
+    {
+        CodeMap routine_map = MapCode(routine.code, routine.entry, routine.entry);
+        std::vector<hword> routine_entries = { routine.entry };
+        dword worst = EstimateCycles(routine.code, routine.entry, routine_map, routine.bounds,
+            routine_entries).routines.at(routine.entry);
+        CPU timed(0);
+        timed.memory.WriteProgram(routine.code, routine.entry);
+        timed.PC = routine.entry;
+        hword rts = routine.entry + routine.code.size() - 1;
+        timed.run_until(rts, 1000);
+        EXPECT_EQ(timed.PC, rts);
+        EXPECT_LE(timed.elapsed() + 6, worst) << std::hex << routine.entry;
+        if (routine.bounds.empty())
+        {
+            EXPECT_EQ(timed.elapsed() + 6, worst);     // Straight-line code is exact
+        }
+    }
+
+    // A full image in one routine of some 21000 blocks, each branching to
+    // the next instruction, is walked without recursion
+    std::vector<byte> full(0xFFF0 - 0x0200);
+    word triples = (full.size() - 1) / 3;
+    for (word i = 0; i < triples; i++)
+    {
+        full[3 * i] = 0x18;         // CLC
+        full[3 * i + 1] = 0x90;     // BCC, to the next instruction
+    }
+    full[3 * triples] = 0x60;       // RTS
+    CodeMap full_map = MapCode(full, 0x0200, 0x0200);
+    EXPECT_EQ(full_map.entries, (std::vector<hword>{ 0x0200 }));
+    EXPECT_EQ(full_map.blocks.size(), triples + 1);
+    EXPECT_EQ(EstimateCycles(full, 0x0200, full_map, {}, full_map.entries).routines.at(0x0200), (dword)triples * 5 + 6);
+
+    // Bounds files
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "af6502_loops.txt";
+    {
+        std::ofstream fout(path);
+        fout << "loop 770 3\n";
+    }
+    LoopBounds bounds;
+    EXPECT_TRUE(LoadLoopBounds(path, bounds));
+    EXPECT_EQ(bounds, (LoopBounds{ { 0x0302, 3 } }));
+    std::filesystem::remove(path);
+}
+
+// Cycle measurement test
+TEST(AF6502Tests, MeasureTest)
+{
+    // Create CPU, timing $0202 up to $0208, with a marker device too
+    MeasureCPU cpu(0);
+    cpu.trace.start = 0x0202;
+    cpu.trace.stop = 0x0208;
+    cpu.trace.histogram = std::make_shared<CycleHistogram>(10, 10);
+    auto marker = std::make_shared<CycleMarker>(cpu);
+    cpu.memory.Attach(marker, 0xF000, 0xF000);
+
+    // Ten passes of a loop running X+1 rounds: 10 + 5X cycles
+    std::vector<byte> program = {
+        0xA2, 0x00,         // LDX #0
+        0x8A, 0xA8, 0xC8,   // $0202: TXA, TAY, INY
+        0x88, 0xD0, 0xFD,   // $0205: DEY, BNE $0205
+        0x8D, 0x00, 0xF0,   // $0208: STA $F000 (marker start)
+        0xEA,               // NOP
+        0x8D, 0x01, 0xF0,   // STA $F001 (marker stop)
+        0xE8, 0xE0, 0x0A,   // INX, CPX #10
+        0xD0, 0xEE,         // BNE $0202
+        0x8D, 0x01, 0xF0    // $0214: STA $F001 (stop without a start)
+    };
+    cpu.memory.WriteProgram(program, 0x0200);
+    cpu.PC = 0x0200;
+    cpu.run_until(0x0217, 10000);
+    EXPECT_EQ(cpu.PC, 0x0217);
+
+    const CycleHistogram& passes = *cpu.trace.histogram;
+    EXPECT_EQ(passes.passes, 10);
+    EXPECT_EQ(passes.shortest, 10);
+    EXPECT_EQ(passes.longest, 55);
+    EXPECT_DOUBLE_EQ(passes.Mean(), 32.5);
+    EXPECT_EQ(passes.below, 0);
+    EXPECT_EQ(passes.buckets[0], 2);    // 10 and 15 cycles
+    EXPECT_EQ(passes.buckets[4], 2);    // 50 and 55 cycles
+    EXPECT_EQ(passes.buckets[5], 0);
+
+    // The stores time the NOP and one store, every time
+    EXPECT_EQ(marker->histogram.passes, 10);
+    EXPECT_EQ(marker->histogram.shortest, 2 + 4);
+    EXPECT_EQ(marker->histogram.longest, 2 + 4);
+    EXPECT_EQ(marker->histogram.buckets[6], 10);
+
+    // Passes past the last bucket are only counted
+    CycleHistogram narrow(1, 0);
+    narrow.Add(CycleHistogram::BUCKETS);
+    EXPECT_EQ(narrow.above, 1);
+    EXPECT_EQ(narrow.passes, 1);
+}
+
 // Execute test
 TEST(AF6502Tests, ExecuteTest)
 {
     FAIL();
 }
-